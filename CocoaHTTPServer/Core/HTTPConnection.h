@@ -1,14 +1,27 @@
 #import <Foundation/Foundation.h>
+#import "HTTPWriteWindow.h"
 
 @class GCDAsyncSocket;
 @class HTTPMessage;
 @class HTTPServer;
 @class WebSocket;
 @protocol HTTPResponse;
+@protocol HTTPDataStore;
 
 
 #define HTTPConnectionDidDieNotification  @"HTTPConnectionDidDie"
 
+// Posted, on the connection's queue, after each response body of at least
+// HTTPConnectionGoodputMinimumLength bytes has been fully written.
+// The userInfo dictionary holds the keys below.
+#define HTTPConnectionDidMeasureGoodputNotification  @"HTTPConnectionDidMeasureGoodput"
+
+#define HTTPConnectionGoodputKey          @"goodput"        // NSNumber, bytes per second
+#define HTTPConnectionResponseLengthKey   @"responseLength" // NSNumber, bytes written
+#define HTTPConnectionRequestURIKey       @"requestURI"     // NSString
+
+#define HTTPConnectionGoodputMinimumLength  (64 * 1024)
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark -
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -18,14 +31,20 @@
 	HTTPServer __unsafe_unretained *server;
 	NSString __strong *documentRoot;
 	dispatch_queue_t queue;
+	id<HTTPDataStore> dataStore;
 }
 
 - (id)initWithServer:(HTTPServer *)server documentRoot:(NSString *)documentRoot;
 - (id)initWithServer:(HTTPServer *)server documentRoot:(NSString *)documentRoot queue:(dispatch_queue_t)q;
+- (id)initWithServer:(HTTPServer *)server
+        documentRoot:(NSString *)documentRoot
+               queue:(dispatch_queue_t)q
+           dataStore:(id<HTTPDataStore>)dataStore;
 
 @property (nonatomic, unsafe_unretained, readonly) HTTPServer *server;
 @property (nonatomic, strong, readonly) NSString *documentRoot;
 @property (nonatomic, readonly) dispatch_queue_t queue;
+@property (nonatomic, strong, readonly) id<HTTPDataStore> dataStore;
 
 @end
 
@@ -50,6 +69,7 @@
 	long lastNC;
 	
 	NSObject<HTTPResponse> *httpResponse;
+	int responseFD;
 	
 	NSMutableArray *ranges;
 	NSMutableArray *ranges_headers;
@@ -61,7 +81,8 @@
 	UInt64 requestChunkSize;
 	UInt64 requestChunkSizeReceived;
   
-	NSMutableArray *responseDataSizes;
+	HTTPWriteWindow *writeWindow;
+	HTTPWriteWindowStatistics responseStartStatistics;
 }
 
 - (id)initWithAsyncSocket:(GCDAsyncSocket *)newSocket configuration:(HTTPConfig *)aConfig;
@@ -111,6 +132,26 @@
 - (BOOL)shouldDie;
 - (void)die;
 
+/**
+ * Returns the current state of the connection's write window,
+ * which limits how much of a response body is queued on the socket at once.
+ * 
+ * The drain rate is a good estimate of how fast the client is currently receiving data.
+ * This method is thread-safe.
+**/
+- (HTTPWriteWindowStatistics)writeWindowStatistics;
+
+/**
+ * Invoked after each response has been fully written, with the rate the client received its body,
+ * counting only the time the socket had data queued.
+ * Time spent waiting on the response itself (such as a file that is still being written) isn't counted,
+ * so this is the throughput of the network path rather than of the server.
+ * 
+ * The default implementation posts HTTPConnectionDidMeasureGoodputNotification for responses that were
+ * long enough to give a meaningful measurement.
+**/
+- (void)didMeasureGoodput:(double)goodput ofResponseWithLength:(UInt64)length;
+
 @end
 
 @interface HTTPConnection (AsynchronousHTTPResponse)
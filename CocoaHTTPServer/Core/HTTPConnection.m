@@ -8,10 +8,14 @@
 #import "DDRange.h"
 #import "DDData.h"
 #import "HTTPFileResponse.h"
+#import "HTTPDataResponse.h"
+#import "HTTPDataStore.h"
 #import "HTTPAsyncFileResponse.h"
 #import "WebSocket.h"
 #import "HTTPLogging.h"
 
+#import <netinet/tcp.h>
+
 #if ! __has_feature(objc_arc)
 #warning This file must be compiled with ARC. Use -fobjc-arc flag (or convert project to ARC).
 #endif
@@ -20,12 +24,15 @@
 // Other flags: trace
 static const int httpLogLevel = HTTP_LOG_LEVEL_WARN; // | HTTP_LOG_FLAG_TRACE;
 
-// Define chunk size used to read in data for responses
-// This is how much data will be read from disk into RAM at a time
+// Define the limits of the write window used to send responses
+// This is how much response data may sit in the socket's write queue at a time (see HTTPWriteWindow)
+#define WRITE_WINDOW_MIN  (1024 * 64)
 #if TARGET_OS_IPHONE
-  #define READ_CHUNKSIZE  (1024 * 256)
+  #define WRITE_WINDOW_INITIAL  (1024 * 256)
+  #define WRITE_WINDOW_MAX      (1024 * 1024 * 2)
 #else
-  #define READ_CHUNKSIZE  (1024 * 512)
+  #define WRITE_WINDOW_INITIAL  (1024 * 512)
+  #define WRITE_WINDOW_MAX      (1024 * 1024 * 8)
 #endif
 
 // Define chunk size used to read in POST upload data
@@ -35,6 +42,9 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_WARN; // | HTTP_LOG_FLAG_TRACE;
   #define POST_CHUNKSIZE  (1024 * 512)
 #endif
 
+// Responses that can't hand us a file descriptor use this in place of one
+#define NULL_FD  -1
+
 // Define the various timeouts (in seconds) for various parts of the HTTP process
 #define TIMEOUT_READ_FIRST_HEADER_LINE       30
 #define TIMEOUT_READ_SUBSEQUENT_HEADER_LINE  30
@@ -208,7 +218,11 @@ static NSMutableArray *recentNonces;
 		
 		numHeaderLines = 0;
 		
-		responseDataSizes = [[NSMutableArray alloc] initWithCapacity:5];
+		responseFD = NULL_FD;
+		
+		writeWindow = [[HTTPWriteWindow alloc] initWithMinimumSize:WRITE_WINDOW_MIN
+		                                               initialSize:WRITE_WINDOW_INITIAL
+		                                               maximumSize:WRITE_WINDOW_MAX];
 	}
 	return self;
 }
@@ -997,6 +1011,8 @@ static NSMutableArray *recentNonces;
 		return;
 	}
 	
+	responseStartStatistics = [writeWindow statistics];
+	
 	[self sendResponseHeadersAndBody];
 }
 
@@ -1220,15 +1236,31 @@ static NSMutableArray *recentNonces;
 		
 		sentResponseHeaders = YES;
 		
+		// File-backed responses can have their body sent without copying it through userspace.
+		// Chunked responses are generated on the fly, so they never qualify.
+		responseFD = NULL_FD;
+		
+		if (!isChunked && [httpResponse respondsToSelector:@selector(fileDescriptor)])
+		{
+			responseFD = [httpResponse fileDescriptor];
+		}
+		
+		// Size the write window for this response from the connection's latest round trip time
+		[self updateWriteWindowRoundTripTime];
+		
 		// Now we need to send the body of the response
 		if (!isRangeRequest)
 		{
 			// Regular request
-			NSData *data = [httpResponse readDataOfLength:READ_CHUNKSIZE];
+			NSData *data = nil;
+			UInt64 fileOffset = 0;
+			NSUInteger length = [self readResponseBodyOfLength:[writeWindow preferredWriteLength]
+			                                              data:&data
+			                                        fileOffset:&fileOffset];
 			
-			if ([data length] > 0)
+			if (length > 0)
 			{
-				[responseDataSizes addObject:[NSNumber numberWithUnsignedInteger:[data length]]];
+				[writeWindow didQueueWriteOfLength:length];
 				
 				if (isChunked)
 				{
@@ -1251,7 +1283,7 @@ static NSMutableArray *recentNonces;
 				else
 				{
 					long tag = [httpResponse isDone] ? HTTP_RESPONSE : HTTP_PARTIAL_RESPONSE_BODY;
-					[asyncSocket writeData:data withTimeout:TIMEOUT_WRITE_BODY tag:tag];
+					[self writeResponseBody:data fileOffset:fileOffset length:length tag:tag];
 				}
 			}
 		}
@@ -1266,16 +1298,19 @@ static NSMutableArray *recentNonces;
 				
 				[httpResponse setOffset:range.location];
 				
-				NSUInteger bytesToRead = range.length < READ_CHUNKSIZE ? (NSUInteger)range.length : READ_CHUNKSIZE;
+				NSUInteger available = [writeWindow preferredWriteLength];
+				NSUInteger bytesToRead = range.length < available ? (NSUInteger)range.length : available;
 				
-				NSData *data = [httpResponse readDataOfLength:bytesToRead];
+				NSData *data = nil;
+				UInt64 fileOffset = 0;
+				NSUInteger length = [self readResponseBodyOfLength:bytesToRead data:&data fileOffset:&fileOffset];
 				
-				if ([data length] > 0)
+				if (length > 0)
 				{
-					[responseDataSizes addObject:[NSNumber numberWithUnsignedInteger:[data length]]];
+					[writeWindow didQueueWriteOfLength:length];
 					
-					long tag = [data length] == range.length ? HTTP_RESPONSE : HTTP_PARTIAL_RANGE_RESPONSE_BODY;
-					[asyncSocket writeData:data withTimeout:TIMEOUT_WRITE_BODY tag:tag];
+					long tag = length == range.length ? HTTP_RESPONSE : HTTP_PARTIAL_RANGE_RESPONSE_BODY;
+					[self writeResponseBody:data fileOffset:fileOffset length:length tag:tag];
 				}
 			}
 			else
@@ -1292,15 +1327,18 @@ static NSMutableArray *recentNonces;
 				
 				[httpResponse setOffset:range.location];
 				
-				NSUInteger bytesToRead = range.length < READ_CHUNKSIZE ? (NSUInteger)range.length : READ_CHUNKSIZE;
+				NSUInteger available = [writeWindow preferredWriteLength];
+				NSUInteger bytesToRead = range.length < available ? (NSUInteger)range.length : available;
 				
-				NSData *data = [httpResponse readDataOfLength:bytesToRead];
+				NSData *data = nil;
+				UInt64 fileOffset = 0;
+				NSUInteger length = [self readResponseBodyOfLength:bytesToRead data:&data fileOffset:&fileOffset];
 				
-				if ([data length] > 0)
+				if (length > 0)
 				{
-					[responseDataSizes addObject:[NSNumber numberWithUnsignedInteger:[data length]]];
+					[writeWindow didQueueWriteOfLength:length];
 					
-					[asyncSocket writeData:data withTimeout:TIMEOUT_WRITE_BODY tag:HTTP_PARTIAL_RANGES_RESPONSE_BODY];
+					[self writeResponseBody:data fileOffset:fileOffset length:length tag:HTTP_PARTIAL_RANGES_RESPONSE_BODY];
 				}
 			}
 		}
@@ -1309,22 +1347,94 @@ static NSMutableArray *recentNonces;
 }
 
 /**
- * Returns the number of bytes of the http response body that are sitting in asyncSocket's write queue.
+ * Gets up to length bytes of the response body, for a subsequent call to writeResponseBody:fileOffset:length:tag:.
+ * 
+ * If the response gave us a file descriptor, nothing is actually read.
+ * The response is advanced past the bytes, and fileOffsetPtr is set to where they begin in the file.
+ * Otherwise the bytes are read via readDataOfLength:, and returned in dataPtr.
  * 
- * We keep track of this information in order to keep our memory footprint low while
- * working with asynchronous HTTPResponse objects.
+ * Returns the number of bytes, which may be zero if an asynchronous response has no data available yet.
 **/
-- (NSUInteger)writeQueueSize
+- (NSUInteger)readResponseBodyOfLength:(NSUInteger)length data:(NSData **)dataPtr fileOffset:(UInt64 *)fileOffsetPtr
 {
-	NSUInteger result = 0;
+	if (responseFD == NULL_FD)
+	{
+		NSData *data = [httpResponse readDataOfLength:length];
+		
+		*dataPtr = data;
+		*fileOffsetPtr = 0;
+		
+		return [data length];
+	}
 	
-	NSUInteger i;
-	for(i = 0; i < [responseDataSizes count]; i++)
+	UInt64 offset = [httpResponse offset];
+	UInt64 contentLength = [httpResponse contentLength];
+	UInt64 bytesLeft = (contentLength > offset) ? (contentLength - offset) : 0;
+	
+	NSUInteger bytesToSend = (NSUInteger)MIN((UInt64)length, bytesLeft);
+	
+	[httpResponse setOffset:(offset + bytesToSend)];
+	
+	*dataPtr = nil;
+	*fileOffsetPtr = offset;
+	
+	return bytesToSend;
+}
+
+/**
+ * Queues a part of the response body, as returned from readResponseBodyOfLength:data:fileOffset:, on asyncSocket.
+**/
+- (void)writeResponseBody:(NSData *)data fileOffset:(UInt64)fileOffset length:(NSUInteger)length tag:(long)tag
+{
+	if (data)
 	{
-		result += [[responseDataSizes objectAtIndex:i] unsignedIntegerValue];
+		[asyncSocket writeData:data withTimeout:TIMEOUT_WRITE_BODY tag:tag];
 	}
+	else
+	{
+		[asyncSocket writeFileDescriptor:responseFD
+		                          offset:fileOffset
+		                          length:length
+		                     withTimeout:TIMEOUT_WRITE_BODY
+		                             tag:tag];
+	}
+}
+
+/**
+ * Feeds the connection's current round trip time, as measured by the kernel, into the write window.
+ * Connections that can't be measured keep the last known value.
+**/
+- (void)updateWriteWindowRoundTripTime
+{
+	__block NSTimeInterval roundTripTime = 0.0;
 	
-	return result;
+	[asyncSocket performBlock:^{
+		
+		int socketFD = [asyncSocket socketFD];
+		if (socketFD == -1) return;
+		
+		struct tcp_connection_info info;
+		socklen_t infoLength = sizeof(info);
+		
+		if (getsockopt(socketFD, IPPROTO_TCP, TCP_CONNECTION_INFO, &info, &infoLength) == 0)
+		{
+			// The smoothed round trip time is reported in milliseconds
+			roundTripTime = info.tcpi_srtt / 1000.0;
+		}
+	}];
+	
+	if (roundTripTime > 0.0)
+	{
+		[writeWindow setRoundTripTime:roundTripTime];
+	}
+}
+
+/**
+ * Returns the current state of the write window.
+**/
+- (HTTPWriteWindowStatistics)writeWindowStatistics
+{
+	return [writeWindow statistics];
 }
 
 /**
@@ -1342,7 +1452,7 @@ static NSMutableArray *recentNonces;
 	// In the case of the asynchronous HTTPResponse, we don't want to blindly grab the new data,
 	// and shove it onto asyncSocket's write queue.
 	// Doing so could negatively affect the memory footprint of the application.
-	// Instead, we always ensure that we place no more than READ_CHUNKSIZE bytes onto the write queue.
+	// Instead, we always ensure that we place no more than the write window's worth of bytes onto the write queue.
 	// 
 	// Note that this does not affect the rate at which the HTTPResponse object may generate data.
 	// The HTTPResponse is free to do as it pleases, and this is up to the application's developer.
@@ -1351,16 +1461,17 @@ static NSMutableArray *recentNonces;
 	// This provides an easy way for the HTTPResponse object to throttle its data allocation in step with the rate
 	// at which the socket is able to send it.
 	
-	NSUInteger writeQueueSize = [self writeQueueSize];
+	NSUInteger available = [writeWindow preferredWriteLength];
 	
-	if(writeQueueSize >= READ_CHUNKSIZE) return;
+	if (available == 0) return;
 	
-	NSUInteger available = READ_CHUNKSIZE - writeQueueSize;
-	NSData *data = [httpResponse readDataOfLength:available];
+	NSData *data = nil;
+	UInt64 fileOffset = 0;
+	NSUInteger length = [self readResponseBodyOfLength:available data:&data fileOffset:&fileOffset];
 	
-	if ([data length] > 0)
+	if (length > 0)
 	{
-		[responseDataSizes addObject:[NSNumber numberWithUnsignedInteger:[data length]]];
+		[writeWindow didQueueWriteOfLength:length];
 		
 		BOOL isChunked = NO;
 		
@@ -1390,7 +1501,7 @@ static NSMutableArray *recentNonces;
 		else
 		{
 			long tag = [httpResponse isDone] ? HTTP_RESPONSE : HTTP_PARTIAL_RESPONSE_BODY;
-			[asyncSocket writeData:data withTimeout:TIMEOUT_WRITE_BODY tag:tag];
+			[self writeResponseBody:data fileOffset:fileOffset length:length tag:tag];
 		}
 	}
 }
@@ -1410,7 +1521,7 @@ static NSMutableArray *recentNonces;
 	// In the case of the asynchronous response, we don't want to blindly grab the new data,
 	// and shove it onto asyncSocket's write queue.
 	// Doing so could negatively affect the memory footprint of the application.
-	// Instead, we always ensure that we place no more than READ_CHUNKSIZE bytes onto the write queue.
+	// Instead, we always ensure that we place no more than the write window's worth of bytes onto the write queue.
 	// 
 	// Note that this does not affect the rate at which the HTTPResponse object may generate data.
 	// The HTTPResponse is free to do as it pleases, and this is up to the application's developer.
@@ -1419,9 +1530,9 @@ static NSMutableArray *recentNonces;
 	// This provides an easy way for the HTTPResponse object to throttle its data allocation in step with the rate
 	// at which the socket is able to send it.
 	
-	NSUInteger writeQueueSize = [self writeQueueSize];
+	NSUInteger available = [writeWindow preferredWriteLength];
 	
-	if(writeQueueSize >= READ_CHUNKSIZE) return;
+	if (available == 0) return;
 	
 	DDRange range = [[ranges objectAtIndex:0] ddrangeValue];
 	
@@ -1431,17 +1542,18 @@ static NSMutableArray *recentNonces;
 	
 	if (bytesLeft > 0)
 	{
-		NSUInteger available = READ_CHUNKSIZE - writeQueueSize;
 		NSUInteger bytesToRead = bytesLeft < available ? (NSUInteger)bytesLeft : available;
 		
-		NSData *data = [httpResponse readDataOfLength:bytesToRead];
+		NSData *data = nil;
+		UInt64 fileOffset = 0;
+		NSUInteger length = [self readResponseBodyOfLength:bytesToRead data:&data fileOffset:&fileOffset];
 		
-		if ([data length] > 0)
+		if (length > 0)
 		{
-			[responseDataSizes addObject:[NSNumber numberWithUnsignedInteger:[data length]]];
+			[writeWindow didQueueWriteOfLength:length];
 			
-			long tag = [data length] == bytesLeft ? HTTP_RESPONSE : HTTP_PARTIAL_RANGE_RESPONSE_BODY;
-			[asyncSocket writeData:data withTimeout:TIMEOUT_WRITE_BODY tag:tag];
+			long tag = length == bytesLeft ? HTTP_RESPONSE : HTTP_PARTIAL_RANGE_RESPONSE_BODY;
+			[self writeResponseBody:data fileOffset:fileOffset length:length tag:tag];
 		}
 	}
 }
@@ -1461,7 +1573,7 @@ static NSMutableArray *recentNonces;
 	// In the case of the asynchronous HTTPResponse, we don't want to blindly grab the new data,
 	// and shove it onto asyncSocket's write queue.
 	// Doing so could negatively affect the memory footprint of the application.
-	// Instead, we always ensure that we place no more than READ_CHUNKSIZE bytes onto the write queue.
+	// Instead, we always ensure that we place no more than the write window's worth of bytes onto the write queue.
 	// 
 	// Note that this does not affect the rate at which the HTTPResponse object may generate data.
 	// The HTTPResponse is free to do as it pleases, and this is up to the application's developer.
@@ -1470,9 +1582,9 @@ static NSMutableArray *recentNonces;
 	// This provides an easy way for the HTTPResponse object to throttle its data allocation in step with the rate
 	// at which the socket is able to send it.
 	
-	NSUInteger writeQueueSize = [self writeQueueSize];
+	NSUInteger available = [writeWindow preferredWriteLength];
 	
-	if(writeQueueSize >= READ_CHUNKSIZE) return;
+	if (available == 0) return;
 	
 	DDRange range = [[ranges objectAtIndex:rangeIndex] ddrangeValue];
 	
@@ -1482,16 +1594,17 @@ static NSMutableArray *recentNonces;
 	
 	if (bytesLeft > 0)
 	{
-		NSUInteger available = READ_CHUNKSIZE - writeQueueSize;
 		NSUInteger bytesToRead = bytesLeft < available ? (NSUInteger)bytesLeft : available;
 		
-		NSData *data = [httpResponse readDataOfLength:bytesToRead];
+		NSData *data = nil;
+		UInt64 fileOffset = 0;
+		NSUInteger length = [self readResponseBodyOfLength:bytesToRead data:&data fileOffset:&fileOffset];
 		
-		if ([data length] > 0)
+		if (length > 0)
 		{
-			[responseDataSizes addObject:[NSNumber numberWithUnsignedInteger:[data length]]];
+			[writeWindow didQueueWriteOfLength:length];
 			
-			[asyncSocket writeData:data withTimeout:TIMEOUT_WRITE_BODY tag:HTTP_PARTIAL_RANGES_RESPONSE_BODY];
+			[self writeResponseBody:data fileOffset:fileOffset length:length tag:HTTP_PARTIAL_RANGES_RESPONSE_BODY];
 		}
 	}
 	else
@@ -1507,16 +1620,17 @@ static NSMutableArray *recentNonces;
 			
 			[httpResponse setOffset:range.location];
 			
-			NSUInteger available = READ_CHUNKSIZE - writeQueueSize;
 			NSUInteger bytesToRead = range.length < available ? (NSUInteger)range.length : available;
 			
-			NSData *data = [httpResponse readDataOfLength:bytesToRead];
+			NSData *data = nil;
+			UInt64 fileOffset = 0;
+			NSUInteger length = [self readResponseBodyOfLength:bytesToRead data:&data fileOffset:&fileOffset];
 			
-			if ([data length] > 0)
+			if (length > 0)
 			{
-				[responseDataSizes addObject:[NSNumber numberWithUnsignedInteger:[data length]]];
+				[writeWindow didQueueWriteOfLength:length];
 				
-				[asyncSocket writeData:data withTimeout:TIMEOUT_WRITE_BODY tag:HTTP_PARTIAL_RANGES_RESPONSE_BODY];
+				[self writeResponseBody:data fileOffset:fileOffset length:length tag:HTTP_PARTIAL_RANGES_RESPONSE_BODY];
 			}
 		}
 		else
@@ -1669,6 +1783,13 @@ static NSMutableArray *recentNonces;
 	
 	NSString *filePath = [self filePathForURI:path allowDirectory:NO];
 	
+	// Files that are kept in memory don't need to be read back from disk
+	NSData *storedData = filePath ? [[config dataStore] dataForFilePath:filePath] : nil;
+	if (storedData)
+	{
+		return [[HTTPDataResponse alloc] initWithData:storedData];
+	}
+	
 	BOOL isDir = NO;
 	
 	if (filePath && [[NSFileManager defaultManager] fileExistsAtPath:filePath isDirectory:&isDir] && !isDir)
@@ -2363,9 +2484,7 @@ static NSMutableArray *recentNonces;
 	if (tag == HTTP_PARTIAL_RESPONSE_BODY)
 	{
 		// Update the amount of data we have in asyncSocket's write queue
-        if ([responseDataSizes count] > 0) {
-            [responseDataSizes removeObjectAtIndex:0];
-        }
+		[writeWindow didCompleteWrite];
 		
 		// We only wrote a part of the response - there may be more
 		[self continueSendingStandardResponseBody];
@@ -2374,9 +2493,7 @@ static NSMutableArray *recentNonces;
 	{
 		// Update the amount of data we have in asyncSocket's write queue.
 		// This will allow asynchronous responses to continue sending more data.
-        if ([responseDataSizes count] > 0) {
-            [responseDataSizes removeObjectAtIndex:0];
-        }
+		[writeWindow didCompleteWrite];
 		// Don't continue sending the response yet.
 		// The chunked footer that was sent after the body will tell us if we have more data to send.
 	}
@@ -2388,28 +2505,21 @@ static NSMutableArray *recentNonces;
 	else if (tag == HTTP_PARTIAL_RANGE_RESPONSE_BODY)
 	{
 		// Update the amount of data we have in asyncSocket's write queue
-        if ([responseDataSizes count] > 0) {
-            [responseDataSizes removeObjectAtIndex:0];
-        }
+		[writeWindow didCompleteWrite];
 		// We only wrote a part of the range - there may be more
 		[self continueSendingSingleRangeResponseBody];
 	}
 	else if (tag == HTTP_PARTIAL_RANGES_RESPONSE_BODY)
 	{
 		// Update the amount of data we have in asyncSocket's write queue
-        if ([responseDataSizes count] > 0) {
-            [responseDataSizes removeObjectAtIndex:0];
-        }
+		[writeWindow didCompleteWrite];
 		// We only wrote part of the range - there may be more, or there may be more ranges
 		[self continueSendingMultiRangeResponseBody];
 	}
 	else if (tag == HTTP_RESPONSE || tag == HTTP_FINAL_RESPONSE)
 	{
 		// Update the amount of data we have in asyncSocket's write queue
-		if ([responseDataSizes count] > 0)
-		{
-			[responseDataSizes removeObjectAtIndex:0];
-		}
+		[writeWindow didCompleteWrite];
 		
 		doneSendingResponse = YES;
 	}
@@ -2575,15 +2685,53 @@ static NSMutableArray *recentNonces;
 	// 
 	// If you override this method, you should take care to invoke [super finishResponse] at some point.
 	
+	if (httpResponse)
+	{
+		HTTPWriteWindowStatistics statistics = [writeWindow statistics];
+		
+		UInt64 length = statistics.bytesWritten - responseStartStatistics.bytesWritten;
+		NSTimeInterval busyTime = statistics.busyTime - responseStartStatistics.busyTime;
+		
+		if (busyTime > 0.0)
+		{
+			[self didMeasureGoodput:(length / busyTime) ofResponseWithLength:length];
+		}
+	}
+	
 	request = nil;
 	
 	httpResponse = nil;
+	responseFD = NULL_FD;
+	
+	[writeWindow reset];
 	
 	ranges = nil;
 	ranges_headers = nil;
 	ranges_boundry = nil;
 }
 
+/**
+ * This method is called after each response has been fully sent, with the rate the client received its body.
+**/
+- (void)didMeasureGoodput:(double)goodput ofResponseWithLength:(UInt64)length
+{
+	HTTPLogTrace();
+	
+	// Override me if you want to use goodput measurements some other way.
+	
+	// Short responses are over before the connection gets up to speed, and mostly measure its round trip time
+	if (length < HTTPConnectionGoodputMinimumLength) return;
+	
+	NSDictionary *userInfo = [NSDictionary dictionaryWithObjectsAndKeys:
+		[NSNumber numberWithDouble:goodput], HTTPConnectionGoodputKey,
+		[NSNumber numberWithUnsignedLongLong:length], HTTPConnectionResponseLengthKey,
+		([self requestURI] ?: @""), HTTPConnectionRequestURIKey, nil];
+	
+	[[NSNotificationCenter defaultCenter] postNotificationName:HTTPConnectionDidMeasureGoodputNotification
+	                                                    object:self
+	                                                  userInfo:userInfo];
+}
+
 /**
  * This method is called after each successful response has been fully sent.
  * It determines whether the connection should stay open and handle another request.
@@ -2664,6 +2812,7 @@ static NSMutableArray *recentNonces;
 @synthesize server;
 @synthesize documentRoot;
 @synthesize queue;
+@synthesize dataStore;
 
 - (id)initWithServer:(HTTPServer *)aServer documentRoot:(NSString *)aDocumentRoot
 {
@@ -2698,6 +2847,18 @@ static NSMutableArray *recentNonces;
 	return self;
 }
 
+- (id)initWithServer:(HTTPServer *)aServer
+        documentRoot:(NSString *)aDocumentRoot
+               queue:(dispatch_queue_t)q
+           dataStore:(id<HTTPDataStore>)aDataStore
+{
+	if ((self = [self initWithServer:aServer documentRoot:aDocumentRoot queue:q]))
+	{
+		dataStore = aDataStore;
+	}
+	return self;
+}
+
 - (void)dealloc
 {
 	#if !OS_OBJECT_USE_OBJC
@@ -0,0 +1,25 @@
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A data store keeps the contents of some files in memory,
+ * so the server can send them without reading them back from disk.
+ * 
+ * Set one on the server with -[HTTPServer setDataStore:].
+ * Connections ask it for every file they are about to serve, and fall back to the file on disk when it returns nil.
+**/
+@protocol HTTPDataStore <NSObject>
+
+/**
+ * Returns the contents of the file at the given path, or nil if the store doesn't have it.
+ * The path is the full, standardized path that the request maps to within the document root.
+ * 
+ * The returned data is sent as-is, and must not be mutated afterwards.
+ * This method is invoked on the connections' queues, so it must be thread-safe.
+**/
+- (nullable NSData *)dataForFilePath:(NSString *)filePath;
+
+@end
+
+NS_ASSUME_NONNULL_END
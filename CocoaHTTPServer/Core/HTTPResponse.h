@@ -75,6 +75,21 @@
 **/
 - (BOOL)isChunked;
 
+/**
+ * If your response is backed by a regular file, you may return an open file descriptor for it here.
+ * HTTPConnection will then send the body straight from the file (using sendfile where possible),
+ * instead of copying it through readDataOfLength:.
+ * 
+ * In this mode readDataOfLength: is never called for the body.
+ * Instead, the connection advances the response through the file with setOffset:,
+ * so isDone must be based on the current offset.
+ * 
+ * The descriptor must stay valid until connectionDidClose is called.
+ * Return -1 if the file can't be opened, and the connection will fall back to readDataOfLength:.
+ * This method is never called for chunked responses.
+**/
+- (int)fileDescriptor;
+
 /**
  * This method is called from the HTTPConnection class when the connection is closed,
  * or when the connection is finished with the response.
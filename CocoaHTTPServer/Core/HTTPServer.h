@@ -1,4 +1,5 @@
 #import <Foundation/Foundation.h>
+#import "HTTPDataStore.h"
 
 @class GCDAsyncSocket;
 @class WebSocket;
@@ -22,10 +23,11 @@
 {
 	// Underlying asynchronous TCP/IP socket
 	GCDAsyncSocket *asyncSocket;
+	NSArray *listenerSockets;
 	
 	// Dispatch queues
 	dispatch_queue_t serverQueue;
-	dispatch_queue_t connectionQueue;
+	NSArray *connectionQueues;
 	void *IsOnServerQueueKey;
 	void *IsOnConnectionQueueKey;
 	
@@ -34,6 +36,9 @@
 	Class connectionClass;
 	NSString *interface;
 	UInt16 port;
+	NSUInteger numberOfConnectionQueues;
+	NSUInteger numberOfListeners;
+	id<HTTPDataStore> dataStore;
 	
 	// NSNetService and related variables
 	NSNetService *netService;
@@ -44,9 +49,9 @@
 	NSDictionary *txtRecordDictionary;
 	
 	// Connection management
-	NSMutableArray *connections;
+	NSArray *connectionShards;
+	id unpooledConnections;
 	NSMutableArray *webSockets;
-	NSLock *connectionsLock;
 	NSLock *webSocketsLock;
 	
 	BOOL isRunning;
@@ -66,6 +71,18 @@
 - (NSString *)documentRoot;
 - (void)setDocumentRoot:(NSString *)value;
 
+/**
+ * An optional store of file contents that are kept in memory.
+ * Requests for files the store has are answered from memory, rather than by reading the file from disk.
+ * 
+ * The default value is nil.
+ * 
+ * If you change the dataStore while the server is running,
+ * the change will affect future incoming http connections.
+**/
+- (id<HTTPDataStore>)dataStore;
+- (void)setDataStore:(id<HTTPDataStore>)value;
+
 /**
  * The connection class is the class used to handle incoming HTTP connections.
  * 
@@ -108,6 +125,38 @@
 - (UInt16)listeningPort;
 - (void)setPort:(UInt16)value;
 
+/**
+ * The number of dispatch queues that client connections are spread across.
+ * 
+ * Each connection does all of its request parsing and response scheduling on one serial queue.
+ * New connections are given whichever queue in the pool currently has the fewest live connections,
+ * so several clients can be parsed and served in parallel, while each individual connection stays serial.
+ * 
+ * The default value is the number of active processor cores.
+ * A value of 1 puts every connection on a single shared queue.
+ * 
+ * You can change this property while the server is running, but it won't affect the running server.
+ * The new pool size takes effect the next time the server is started.
+**/
+- (NSUInteger)numberOfConnectionQueues;
+- (void)setNumberOfConnectionQueues:(NSUInteger)value;
+
+/**
+ * The number of listening sockets that accept incoming connections.
+ * 
+ * When this is greater than 1, every listener binds the same interface and port with SO_REUSEPORT,
+ * and each one accepts and sets up its connections on its own dispatch queue.
+ * The listeners only briefly visit the server queue to pick a connection queue for each new connection.
+ * 
+ * The default value is 1, which accepts every connection on the server queue.
+ * If the additional listeners can't be started, the server keeps running with the ones that did start.
+ * 
+ * You can change this property while the server is running, but it won't affect the running server.
+ * The new number of listeners takes effect the next time the server is started.
+**/
+- (NSUInteger)numberOfListeners;
+- (void)setNumberOfListeners:(NSUInteger)value;
+
 /**
  * Bonjour domain for publishing the service.
  * The default value is "local.".
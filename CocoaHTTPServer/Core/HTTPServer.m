@@ -12,11 +12,41 @@
 // Other flags: trace
 static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 
+/**
+ * The connections that run on a single connection queue, guarded by their own lock.
+ * 
+ * Each connection queue carries its shard as queue specific data,
+ * so a connection can be registered and unregistered without touching any other queue's shard.
+**/
+@interface HTTPConnectionShard : NSObject
+{
+	NSMutableArray *connections;
+	NSLock *lock;
+}
+
+- (void)addConnection:(HTTPConnection *)connection;
+- (void)removeConnection:(HTTPConnection *)connection;
+- (NSArray *)removeAllConnections;
+- (NSUInteger)count;
+
+@end
+
+static void HTTPConnectionShardRelease(void *context)
+{
+	CFRelease(context);
+}
+
 @interface HTTPServer (PrivateAPI)
 
 - (void)unpublishBonjour;
 - (void)publishBonjour;
 
+- (void)setupConnectionQueues;
+- (dispatch_queue_t)leastLoadedConnectionQueue;
+
+- (void)startAdditionalListeners;
+- (void)stopAdditionalListeners;
+
 + (void)startBonjourThreadIfNeeded;
 + (void)performBonjourBlock:(dispatch_block_t)block;
 
@@ -40,7 +70,6 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 		
 		// Setup underlying dispatch queues
 		serverQueue = dispatch_queue_create("HTTPServer", NULL);
-		connectionQueue = dispatch_queue_create("HTTPConnection", NULL);
 		
 		IsOnServerQueueKey = &IsOnServerQueueKey;
 		IsOnConnectionQueueKey = &IsOnConnectionQueueKey;
@@ -48,7 +77,12 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 		void *nonNullUnusedPointer = (__bridge void *)self; // Whatever, just not null
 		
 		dispatch_queue_set_specific(serverQueue, IsOnServerQueueKey, nonNullUnusedPointer, NULL);
-		dispatch_queue_set_specific(connectionQueue, IsOnConnectionQueueKey, nonNullUnusedPointer, NULL);
+		
+		// Spread connections over one queue per core by default
+		numberOfConnectionQueues = [[NSProcessInfo processInfo] activeProcessorCount];
+		
+		// Accept every connection on the server queue by default
+		numberOfListeners = 1;
 		
 		// Initialize underlying GCD based tcp socket
 		asyncSocket = [[GCDAsyncSocket alloc] initWithDelegate:self delegateQueue:serverQueue];
@@ -74,13 +108,16 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 		// by automatically appending a digit to the end of the name.
 		name = @"";
 		
-		// Initialize arrays to hold all the HTTP and webSocket connections
-		connections = [[NSMutableArray alloc] init];
+		// Initialize the registries for all the HTTP and webSocket connections.
+		// HTTP connections are registered per connection queue (see setupConnectionQueues),
+		// with a separate shard for connections on queues provided by a custom config.
+		unpooledConnections = [[HTTPConnectionShard alloc] init];
 		webSockets  = [[NSMutableArray alloc] init];
 		
-		connectionsLock = [[NSLock alloc] init];
 		webSocketsLock  = [[NSLock alloc] init];
 		
+		[self setupConnectionQueues];
+		
 		// Register for notifications of closed connections
 		[[NSNotificationCenter defaultCenter] addObserver:self
 		                                         selector:@selector(connectionDidDie:)
@@ -116,7 +153,6 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 	
 	#if !OS_OBJECT_USE_OBJC
 	dispatch_release(serverQueue);
-	dispatch_release(connectionQueue);
 	#endif
 	
 	[asyncSocket setDelegate:nil delegateQueue:NULL];
@@ -164,6 +200,29 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 	
 }
 
+/**
+ * The data store that connections check before reading files from disk.
+**/
+- (id<HTTPDataStore>)dataStore
+{
+	__block id<HTTPDataStore> result;
+	
+	dispatch_sync(serverQueue, ^{
+		result = dataStore;
+	});
+	
+	return result;
+}
+
+- (void)setDataStore:(id<HTTPDataStore>)value
+{
+	HTTPLogTrace();
+	
+	dispatch_async(serverQueue, ^{
+		dataStore = value;
+	});
+}
+
 /**
  * The connection class is the class that will be used to handle connections.
  * That is, when a new connection is created, an instance of this class will be intialized.
@@ -253,6 +312,52 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 	});
 }
 
+/**
+ * The number of serial queues that connections are distributed over.
+**/
+- (NSUInteger)numberOfConnectionQueues
+{
+	__block NSUInteger result;
+	
+	dispatch_sync(serverQueue, ^{
+		result = numberOfConnectionQueues;
+	});
+	
+	return result;
+}
+
+- (void)setNumberOfConnectionQueues:(NSUInteger)value
+{
+	HTTPLogTrace();
+	
+	dispatch_async(serverQueue, ^{
+		numberOfConnectionQueues = MAX(value, (NSUInteger)1);
+	});
+}
+
+/**
+ * The number of listening sockets sharing the port.
+**/
+- (NSUInteger)numberOfListeners
+{
+	__block NSUInteger result;
+	
+	dispatch_sync(serverQueue, ^{
+		result = numberOfListeners;
+	});
+	
+	return result;
+}
+
+- (void)setNumberOfListeners:(NSUInteger)value
+{
+	HTTPLogTrace();
+	
+	dispatch_async(serverQueue, ^{
+		numberOfListeners = MAX(value, (NSUInteger)1);
+	});
+}
+
 /**
  * Domain on which to broadcast this service via Bonjour.
  * The default domain is @"local".
@@ -410,11 +515,23 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 	
 	dispatch_sync(serverQueue, ^{ @autoreleasepool {
 		
+		if ([connectionQueues count] != numberOfConnectionQueues)
+		{
+			[self setupConnectionQueues];
+		}
+		
+		[asyncSocket setReusePortEnabled:(numberOfListeners > 1)];
+		
 		success = [asyncSocket acceptOnInterface:interface port:port error:&err];
 		if (success)
 		{
 			HTTPLogInfo(@"%@: Started HTTP server on port %hu", THIS_FILE, [asyncSocket localPort]);
 			
+			if (numberOfListeners > 1)
+			{
+				[self startAdditionalListeners];
+			}
+			
 			isRunning = YES;
 			[self publishBonjour];
 		}
@@ -446,18 +563,19 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 		
 		// Stop listening / accepting incoming connections
 		[asyncSocket disconnect];
+		[self stopAdditionalListeners];
 		isRunning = NO;
 		
 		if (!keepExistingConnections)
 		{
 			// Stop all HTTP connections the server owns
-			[connectionsLock lock];
-			for (HTTPConnection *connection in connections)
+			for (HTTPConnectionShard *shard in [connectionShards arrayByAddingObject:unpooledConnections])
 			{
-				[connection stop];
+				for (HTTPConnection *connection in [shard removeAllConnections])
+				{
+					[connection stop];
+				}
 			}
-			[connections removeAllObjects];
-			[connectionsLock unlock];
 			
 			// Stop all WebSocket connections the server owns
 			[webSocketsLock lock];
@@ -501,11 +619,21 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 **/
 - (NSUInteger)numberOfHTTPConnections
 {
-	NSUInteger result = 0;
+	__block NSUInteger result = 0;
 	
-	[connectionsLock lock];
-	result = [connections count];
-	[connectionsLock unlock];
+	dispatch_block_t block = ^{
+		
+		for (HTTPConnectionShard *shard in connectionShards)
+		{
+			result += [shard count];
+		}
+		result += [unpooledConnections count];
+	};
+	
+	if (dispatch_get_specific(IsOnServerQueueKey))
+		block();
+	else
+		dispatch_sync(serverQueue, block);
 	
 	return result;
 }
@@ -528,6 +656,71 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 #pragma mark Incoming Connections
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Creates the pool of connection queues, sized by numberOfConnectionQueues, along with a registry shard for each.
+ * Connections from a previous pool keep their queues and shards until they die,
+ * but are no longer counted towards the load of the new pool.
+**/
+- (void)setupConnectionQueues
+{
+	HTTPLogTrace();
+	
+	NSUInteger count = MAX(numberOfConnectionQueues, (NSUInteger)1);
+	NSMutableArray *queues = [NSMutableArray arrayWithCapacity:count];
+	NSMutableArray *shards = [NSMutableArray arrayWithCapacity:count];
+	
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		HTTPConnectionShard *shard = [[HTTPConnectionShard alloc] init];
+		
+		// The queue owns its shard, and releases it when the queue itself goes away
+		dispatch_queue_t queue = dispatch_queue_create("HTTPConnection", NULL);
+		dispatch_queue_set_specific(queue, IsOnConnectionQueueKey, (__bridge_retained void *)shard,
+		                            HTTPConnectionShardRelease);
+		
+		[queues addObject:queue];
+		[shards addObject:shard];
+	}
+	
+	for (HTTPConnectionShard *shard in connectionShards)
+	{
+		if ([shard count] > 0)
+		{
+			[shards addObject:shard];
+		}
+	}
+	
+	connectionQueues = [queues copy];
+	connectionShards = [shards copy];
+}
+
+/**
+ * Returns the connection queue with the fewest live connections.
+ * Ties go to the lowest-numbered queue, so a lightly loaded server keeps its connections together.
+ * 
+ * A connection only counts towards its queue once it's registered, which happens right after it's created.
+ * With several listeners, two connections accepted at the same moment may therefore land on the same queue.
+**/
+- (dispatch_queue_t)leastLoadedConnectionQueue
+{
+	NSAssert(dispatch_get_specific(IsOnServerQueueKey) != NULL, @"Must be on serverQueue");
+	
+	NSUInteger leastLoadedIndex = 0;
+	NSUInteger leastLoad = [[connectionShards objectAtIndex:0] count];
+	
+	for (NSUInteger i = 1; i < [connectionQueues count]; i++)
+	{
+		NSUInteger load = [[connectionShards objectAtIndex:i] count];
+		if (load < leastLoad)
+		{
+			leastLoadedIndex = i;
+			leastLoad = load;
+		}
+	}
+	
+	return [connectionQueues objectAtIndex:leastLoadedIndex];
+}
+
 - (HTTPConfig *)config
 {
 	// Override me if you want to provide a custom config to the new connection.
@@ -540,21 +733,104 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 	// 
 	// Try the apache benchmark tool (already installed on your Mac):
 	// $  ab -n 1000 -c 1 http://localhost:<port>/some_path.html
+	// 
+	// Each connection is given the least loaded queue of a small pool instead (see numberOfConnectionQueues).
+	
+	// Note: This method is always invoked on serverQueue, even when several listeners are accepting connections.
 	
-	return [[HTTPConfig alloc] initWithServer:self documentRoot:documentRoot queue:connectionQueue];
+	return [[HTTPConfig alloc] initWithServer:self
+	                             documentRoot:documentRoot
+	                                    queue:[self leastLoadedConnectionQueue]
+	                                dataStore:dataStore];
 }
 
 - (void)socket:(GCDAsyncSocket *)sock didAcceptNewSocket:(GCDAsyncSocket *)newSocket
 {
-	HTTPConnection *newConnection = (HTTPConnection *)[[connectionClass alloc] initWithAsyncSocket:newSocket
-	                                                                                 configuration:[self config]];
-	[connectionsLock lock];
-	[connections addObject:newConnection];
-	[connectionsLock unlock];
+	// Note: The primary listener invokes this method on serverQueue.
+	// Additional listeners (see numberOfListeners) invoke it on their own accept queues,
+	// and only step onto serverQueue long enough to read the server configuration.
+	
+	__block Class newConnectionClass;
+	__block HTTPConfig *newConfig;
+	
+	dispatch_block_t block = ^{
+		newConnectionClass = connectionClass;
+		newConfig = [self config];
+	};
+	
+	if (dispatch_get_specific(IsOnServerQueueKey))
+		block();
+	else
+		dispatch_sync(serverQueue, block);
+	
+	HTTPConnection *newConnection = (HTTPConnection *)[[newConnectionClass alloc] initWithAsyncSocket:newSocket
+	                                                                                    configuration:newConfig];
+	
+	// A custom config may choose its own queue, which won't have a shard of its own
+	HTTPConnectionShard *shard = nil;
+	if (newConfig.queue)
+	{
+		shard = (__bridge HTTPConnectionShard *)dispatch_queue_get_specific(newConfig.queue, IsOnConnectionQueueKey);
+	}
+	
+	[(shard ? shard : unpooledConnections) addConnection:newConnection];
 	
 	[newConnection start];
 }
 
+/**
+ * Starts the listeners beyond the primary one, all sharing the primary listener's port.
+**/
+- (void)startAdditionalListeners
+{
+	HTTPLogTrace();
+	
+	NSAssert(dispatch_get_specific(IsOnServerQueueKey) != NULL, @"Must be on serverQueue");
+	
+	// Use the port the primary listener actually bound, in case the kernel picked it for us
+	UInt16 sharedPort = [asyncSocket localPort];
+	
+	NSMutableArray *sockets = [NSMutableArray arrayWithCapacity:(numberOfListeners - 1)];
+	
+	for (NSUInteger i = 1; i < numberOfListeners; i++)
+	{
+		dispatch_queue_t acceptQueue = dispatch_queue_create("HTTPServer-Accept", NULL);
+		
+		GCDAsyncSocket *listener = [[GCDAsyncSocket alloc] initWithDelegate:self delegateQueue:acceptQueue];
+		[listener setReusePortEnabled:YES];
+		
+		NSError *err = nil;
+		if (![listener acceptOnInterface:interface port:sharedPort error:&err])
+		{
+			HTTPLogWarn(@"%@: Failed to start additional listener on port %hu: %@", THIS_FILE, sharedPort, err);
+			
+			[listener setDelegate:nil delegateQueue:NULL];
+			break;
+		}
+		
+		[sockets addObject:listener];
+	}
+	
+	HTTPLogInfo(@"%@: Accepting on %lu listeners", THIS_FILE, (unsigned long)([sockets count] + 1));
+	
+	listenerSockets = [sockets copy];
+}
+
+- (void)stopAdditionalListeners
+{
+	HTTPLogTrace();
+	
+	NSAssert(dispatch_get_specific(IsOnServerQueueKey) != NULL, @"Must be on serverQueue");
+	
+	for (GCDAsyncSocket *listener in listenerSockets)
+	{
+		[listener setDelegate:nil delegateQueue:NULL];
+		[listener disconnect];
+	}
+	
+	listenerSockets = nil;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Bonjour
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -669,12 +945,11 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_INFO; // | HTTP_LOG_FLAG_TRACE;
 {
 	// Note: This method is called on the connection queue that posted the notification
 	
-	[connectionsLock lock];
-	
 	HTTPLogTrace();
-	[connections removeObject:[notification object]];
 	
-	[connectionsLock unlock];
+	HTTPConnectionShard *shard = (__bridge HTTPConnectionShard *)dispatch_get_specific(IsOnConnectionQueueKey);
+	
+	[(shard ? shard : unpooledConnections) removeConnection:[notification object]];
 }
 
 /**
@@ -770,3 +1045,56 @@ static NSThread *bonjourThread;
 }
 
 @end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation HTTPConnectionShard
+
+- (id)init
+{
+	if ((self = [super init]))
+	{
+		connections = [[NSMutableArray alloc] init];
+		lock = [[NSLock alloc] init];
+	}
+	return self;
+}
+
+- (void)addConnection:(HTTPConnection *)connection
+{
+	[lock lock];
+	[connections addObject:connection];
+	[lock unlock];
+}
+
+- (void)removeConnection:(HTTPConnection *)connection
+{
+	[lock lock];
+	[connections removeObjectIdenticalTo:connection];
+	[lock unlock];
+}
+
+- (NSArray *)removeAllConnections
+{
+	[lock lock];
+	NSArray *result = [connections copy];
+	[connections removeAllObjects];
+	[lock unlock];
+	
+	return result;
+}
+
+- (NSUInteger)count
+{
+	NSUInteger result;
+	
+	[lock lock];
+	result = [connections count];
+	[lock unlock];
+	
+	return result;
+}
+
+@end
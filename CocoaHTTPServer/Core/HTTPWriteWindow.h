@@ -0,0 +1,77 @@
+/**
+ * The HTTPWriteWindow class decides how many bytes of a response body an HTTPConnection
+ * may have sitting in its socket's write queue at once.
+ *
+ * Rather than a fixed cap, the window is sized from the rate at which the socket drains its write queue,
+ * and the round trip time of the connection (roughly their product, the bandwidth-delay product).
+ * Fast wired receivers get a window large enough to keep the socket busy,
+ * while slow wireless receivers don't tie up memory with data they can't take yet.
+**/
+
+#import <Foundation/Foundation.h>
+
+typedef struct HTTPWriteWindowStatistics
+{
+	NSUInteger windowSize;        // Current window, in bytes
+	NSUInteger bytesInFlight;     // Bytes queued on the socket but not yet written
+	double drainRate;             // Smoothed rate the socket accepts queued bytes, in bytes per second
+	NSTimeInterval roundTripTime; // Latest round trip time of the connection, or 0 if unknown
+	UInt64 bytesWritten;          // Total bytes written through the window
+	NSTimeInterval busyTime;      // Total time the socket has spent with writes in flight
+} HTTPWriteWindowStatistics;
+
+
+@interface HTTPWriteWindow : NSObject
+
+/**
+ * Creates a window that starts out at initialSize bytes,
+ * and then adapts within the range [minimumSize, maximumSize].
+**/
+- (id)initWithMinimumSize:(NSUInteger)minimumSize
+              initialSize:(NSUInteger)initialSize
+              maximumSize:(NSUInteger)maximumSize;
+
+/**
+ * The number of bytes that may be queued right now without exceeding the window.
+ * Returns zero if the window is full.
+**/
+- (NSUInteger)availableSpace;
+
+/**
+ * The largest single write worth queueing right now.
+ * This is the available space, limited so the window is always split over a few writes,
+ * which keeps the socket busy while the next write is being prepared.
+**/
+- (NSUInteger)preferredWriteLength;
+
+/**
+ * Records a write of the given length that was just queued on the socket.
+**/
+- (void)didQueueWriteOfLength:(NSUInteger)length;
+
+/**
+ * Records that the oldest queued write has been completely written,
+ * and adapts the window to the updated drain rate.
+ *
+ * Returns the length of the completed write, or zero if there were no writes in flight.
+**/
+- (NSUInteger)didCompleteWrite;
+
+/**
+ * Records the most recently measured round trip time of the connection.
+**/
+- (void)setRoundTripTime:(NSTimeInterval)roundTripTime;
+
+/**
+ * Forgets about any writes in flight, such as when a response is finished or abandoned.
+ * The measured drain rate and round trip time are kept, as they describe the connection rather than the response.
+**/
+- (void)reset;
+
+/**
+ * Returns a snapshot of the window's current state.
+ * This method is thread-safe.
+**/
+- (HTTPWriteWindowStatistics)statistics;
+
+@end
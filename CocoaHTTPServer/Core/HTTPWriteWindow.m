@@ -0,0 +1,199 @@
+#import "HTTPWriteWindow.h"
+#import <mach/mach_time.h>
+
+#if ! __has_feature(objc_arc)
+#warning This file must be compiled with ARC. Use -fobjc-arc flag (or convert project to ARC).
+#endif
+
+// The most writes we keep track of at once.
+// Once this many writes are in flight, the window is considered full regardless of its size.
+#define MAX_WRITES_IN_FLIGHT  64
+
+// The window is split over at least this many writes
+#define MIN_WRITES_PER_WINDOW  4
+
+// How long we allow for queueing the next write after one completes, in seconds.
+// The window covers this in addition to the round trip time, so the socket doesn't sit idle in between.
+#define REFILL_TIME  0.020
+
+// Weight given to each new drain rate sample, as in TCP's smoothed round trip time
+#define DRAIN_RATE_GAIN  0.125
+
+// Ignore drain rate samples over intervals shorter than this, in seconds, as they're mostly timer noise
+#define MIN_SAMPLE_INTERVAL  0.001
+
+typedef struct HTTPQueuedWrite
+{
+	NSUInteger length;
+	uint64_t queuedTime;
+} HTTPQueuedWrite;
+
+
+@implementation HTTPWriteWindow
+{
+	NSUInteger minimumSize;
+	NSUInteger maximumSize;
+	NSUInteger windowSize;
+	
+	// Writes in flight, oldest first, in a ring buffer
+	HTTPQueuedWrite writes[MAX_WRITES_IN_FLIGHT];
+	NSUInteger writesHead;
+	NSUInteger writesCount;
+	NSUInteger bytesInFlight;
+	
+	uint64_t lastCompletionTime;
+	double drainRate;
+	NSTimeInterval roundTripTime;
+	UInt64 bytesWritten;
+	NSTimeInterval busyTime;
+	
+	// Guards the fields above when a snapshot is taken from another thread
+	NSLock *lock;
+}
+
+static double HTTPWriteWindowSecondsPerTick(void)
+{
+	static double secondsPerTick;
+	static dispatch_once_t onceToken;
+	
+	dispatch_once(&onceToken, ^{
+		mach_timebase_info_data_t timebase;
+		mach_timebase_info(&timebase);
+		
+		secondsPerTick = (double)timebase.numer / (double)timebase.denom / NSEC_PER_SEC;
+	});
+	
+	return secondsPerTick;
+}
+
+- (id)initWithMinimumSize:(NSUInteger)aMinimumSize
+              initialSize:(NSUInteger)anInitialSize
+              maximumSize:(NSUInteger)aMaximumSize
+{
+	if ((self = [super init]))
+	{
+		minimumSize = aMinimumSize;
+		maximumSize = MAX(aMaximumSize, aMinimumSize);
+		windowSize = MIN(MAX(anInitialSize, minimumSize), maximumSize);
+		
+		lock = [[NSLock alloc] init];
+	}
+	return self;
+}
+
+- (NSUInteger)availableSpace
+{
+	if (writesCount >= MAX_WRITES_IN_FLIGHT) return 0;
+	if (bytesInFlight >= windowSize) return 0;
+	
+	return windowSize - bytesInFlight;
+}
+
+- (NSUInteger)preferredWriteLength
+{
+	NSUInteger writeLength = MAX(windowSize / MIN_WRITES_PER_WINDOW, minimumSize);
+	
+	return MIN([self availableSpace], writeLength);
+}
+
+- (void)didQueueWriteOfLength:(NSUInteger)length
+{
+	NSAssert(writesCount < MAX_WRITES_IN_FLIGHT, @"Too many writes in flight");
+	
+	[lock lock];
+	
+	NSUInteger tail = (writesHead + writesCount) % MAX_WRITES_IN_FLIGHT;
+	
+	writes[tail].length = length;
+	writes[tail].queuedTime = mach_absolute_time();
+	
+	writesCount++;
+	bytesInFlight += length;
+	
+	[lock unlock];
+}
+
+- (NSUInteger)didCompleteWrite
+{
+	if (writesCount == 0) return 0;
+	
+	[lock lock];
+	
+	HTTPQueuedWrite write = writes[writesHead];
+	
+	writesHead = (writesHead + 1) % MAX_WRITES_IN_FLIGHT;
+	writesCount--;
+	bytesInFlight -= write.length;
+	bytesWritten += write.length;
+	
+	// The socket has been busy with this write since it was queued,
+	// or since the write before it completed, whichever happened later.
+	
+	uint64_t now = mach_absolute_time();
+	uint64_t busySince = MAX(write.queuedTime, lastCompletionTime);
+	lastCompletionTime = now;
+	
+	double interval = (now - busySince) * HTTPWriteWindowSecondsPerTick();
+	busyTime += interval;
+	
+	if (interval >= MIN_SAMPLE_INTERVAL)
+	{
+		double sample = write.length / interval;
+		
+		if (drainRate == 0.0)
+			drainRate = sample;
+		else
+			drainRate += DRAIN_RATE_GAIN * (sample - drainRate);
+		
+		// Size the window to cover the bytes the socket drains over one round trip, plus the time to refill it.
+		// Move a quarter of the way there at a time, so a single odd sample doesn't swing the window around.
+		
+		double target = drainRate * (roundTripTime + REFILL_TIME);
+		target = MIN(MAX(target, (double)minimumSize), (double)maximumSize);
+		
+		windowSize = (NSUInteger)((3.0 * windowSize + target) / 4.0);
+	}
+	
+	[lock unlock];
+	
+	return write.length;
+}
+
+- (void)setRoundTripTime:(NSTimeInterval)aRoundTripTime
+{
+	[lock lock];
+	roundTripTime = aRoundTripTime;
+	[lock unlock];
+}
+
+- (void)reset
+{
+	[lock lock];
+	
+	writesHead = 0;
+	writesCount = 0;
+	bytesInFlight = 0;
+	lastCompletionTime = 0;
+	
+	[lock unlock];
+}
+
+- (HTTPWriteWindowStatistics)statistics
+{
+	HTTPWriteWindowStatistics result;
+	
+	[lock lock];
+	
+	result.windowSize = windowSize;
+	result.bytesInFlight = bytesInFlight;
+	result.drainRate = drainRate;
+	result.roundTripTime = roundTripTime;
+	result.bytesWritten = bytesWritten;
+	result.busyTime = busyTime;
+	
+	[lock unlock];
+	
+	return result;
+}
+
+@end
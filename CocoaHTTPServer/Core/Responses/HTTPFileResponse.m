@@ -204,6 +204,20 @@ static const int httpLogLevel = HTTP_LOG_LEVEL_WARN; // | HTTP_LOG_FLAG_TRACE;
 	}
 }
 
+- (int)fileDescriptor
+{
+	HTTPLogTrace();
+	
+	if (![self openFileIfNeeded])
+	{
+		// File opening failed,
+		// or response has been aborted due to another error.
+		return NULL_FD;
+	}
+	
+	return fileFD;
+}
+
 - (BOOL)isDone
 {
 	BOOL result = (fileOffset == fileLength);
@@ -151,6 +151,18 @@ typedef enum GCDAsyncSocketError GCDAsyncSocketError;
 - (BOOL)isIPv4PreferredOverIPv6;
 - (void)setPreferIPv4OverIPv6:(BOOL)flag;
 
+/**
+ * By default, an accepting socket has its port to itself.
+ * 
+ * If you enable port reuse, the socket sets SO_REUSEPORT before binding,
+ * which allows several accepting sockets (each with their own queues) to listen on the same interface and port.
+ * Every socket sharing the port must enable this option before calling one of the accept methods.
+ * 
+ * This option only affects subsequent calls to the accept methods.
+**/
+- (BOOL)isReusePortEnabled;
+- (void)setReusePortEnabled:(BOOL)flag;
+
 /**
  * User data allows you to associate arbitrary information with the socket.
  * This data is not used internally by socket in any way.
@@ -649,6 +661,26 @@ typedef enum GCDAsyncSocketError GCDAsyncSocketError;
 **/
 - (void)writeData:(NSData *)data withTimeout:(NSTimeInterval)timeout tag:(long)tag;
 
+/**
+ * Writes a range of a file to the socket, and calls the delegate when finished.
+ * 
+ * This is the zero-copy counterpart to writeData:withTimeout:tag:.
+ * Over a raw socket the range is sent with sendfile, so the bytes never pass through userspace.
+ * Over SSL/TLS the range is read into memory when the write is dequeued, and then encrypted as usual.
+ * Either way the bytes on the wire are identical.
+ * 
+ * The file descriptor is duplicated, so you may close yours as soon as this method returns.
+ * If the file is shorter than offset + length when the write happens, the socket is closed with an error.
+ * 
+ * If you pass in an invalid descriptor or a zero length, this method does nothing and the delegate will not be called.
+ * If the timeout value is negative, the write operation will not use a timeout.
+**/
+- (void)writeFileDescriptor:(int)fd
+                     offset:(UInt64)offset
+                     length:(NSUInteger)length
+                withTimeout:(NSTimeInterval)timeout
+                        tag:(long)tag;
+
 /**
  * Returns progress of the current write, from 0.0 to 1.0, or NaN if no current write (use isnan() to check).
  * The parameters "tag", "done" and "total" will be filled in if they aren't NULL.
@@ -172,6 +172,7 @@ enum GCDAsyncSocketConfig
 	kIPv6Disabled              = 1 << 1,  // If set, IPv6 is disabled
 	kPreferIPv6                = 1 << 2,  // If set, IPv6 is preferred over IPv4
 	kAllowHalfDuplexConnection = 1 << 3,  // If set, the socket will stay open even if the read stream closes
+	kReusePort                 = 1 << 4,  // If set, accepting sockets may share their port with other sockets
 };
 
 #if TARGET_OS_IPHONE
@@ -974,6 +975,7 @@ enum GCDAsyncSocketConfig
 	NSTimeInterval timeout;
 }
 - (id)initWithData:(NSData *)d timeout:(NSTimeInterval)t tag:(long)i;
+- (NSUInteger)length;
 @end
 
 @implementation GCDAsyncWritePacket
@@ -990,6 +992,88 @@ enum GCDAsyncSocketConfig
 	return self;
 }
 
+- (NSUInteger)length
+{
+	return [buffer length];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The GCDAsyncFileWritePacket writes a range of a file, rather than an in-memory buffer.
+ * 
+ * Over a raw socket the range is handed to the kernel with sendfile, so the bytes are never copied into userspace.
+ * Over SSL/TLS the range is read into the buffer ivar first, and then written like any other packet.
+**/
+@interface GCDAsyncFileWritePacket : GCDAsyncWritePacket
+{
+  @public
+	int fileFD;
+	off_t fileOffset;
+	NSUInteger fileLength;
+}
+- (id)initWithFileDescriptor:(int)fd offset:(off_t)offset length:(NSUInteger)length timeout:(NSTimeInterval)t tag:(long)i;
+- (BOOL)readIntoBuffer;
+@end
+
+@implementation GCDAsyncFileWritePacket
+
+- (id)initWithFileDescriptor:(int)fd offset:(off_t)offset length:(NSUInteger)length timeout:(NSTimeInterval)t tag:(long)i
+{
+	if((self = [super initWithData:nil timeout:t tag:i]))
+	{
+		// Dup the descriptor so that the caller is free to close theirs
+		// while this packet is still sitting in the write queue.
+		fileFD = dup(fd);
+		fileOffset = offset;
+		fileLength = length;
+	}
+	return self;
+}
+
+- (NSUInteger)length
+{
+	return fileLength;
+}
+
+/**
+ * Reads the file range into the buffer ivar, for writes that can't be handed to sendfile.
+ * The buffer then holds exactly the bytes that sendfile would have sent.
+**/
+- (BOOL)readIntoBuffer
+{
+	if (buffer) return YES;
+	if (fileFD == SOCKET_NULL) return NO;
+	
+	NSMutableData *data = [NSMutableData dataWithLength:fileLength];
+	uint8_t *bytes = (uint8_t *)[data mutableBytes];
+	
+	NSUInteger bytesRead = 0;
+	while (bytesRead < fileLength)
+	{
+		ssize_t result = pread(fileFD, bytes + bytesRead, fileLength - bytesRead, fileOffset + (off_t)bytesRead);
+		
+		if (result < 0 && errno == EINTR) continue;
+		if (result <= 0) return NO;
+		
+		bytesRead += result;
+	}
+	
+	buffer = data;
+	return YES;
+}
+
+- (void)dealloc
+{
+	if (fileFD != SOCKET_NULL)
+	{
+		close(fileFD);
+	}
+}
 
 @end
 
@@ -1412,6 +1496,40 @@ enum GCDAsyncSocketConfig
 		dispatch_async(socketQueue, block);
 }
 
+- (BOOL)isReusePortEnabled
+{
+	if (dispatch_get_specific(IsOnSocketQueueOrTargetQueueKey))
+	{
+		return ((config & kReusePort) != 0);
+	}
+	else
+	{
+		__block BOOL result;
+		
+		dispatch_sync(socketQueue, ^{
+			result = ((config & kReusePort) != 0);
+		});
+		
+		return result;
+	}
+}
+
+- (void)setReusePortEnabled:(BOOL)flag
+{
+	dispatch_block_t block = ^{
+		
+		if (flag)
+			config |= kReusePort;
+		else
+			config &= ~kReusePort;
+	};
+	
+	if (dispatch_get_specific(IsOnSocketQueueOrTargetQueueKey))
+		block();
+	else
+		dispatch_async(socketQueue, block);
+}
+
 - (id)userData
 {
 	__block id result = nil;
@@ -1506,6 +1624,20 @@ enum GCDAsyncSocketConfig
 			return SOCKET_NULL;
 		}
 		
+		if (config & kReusePort)
+		{
+			status = setsockopt(socketFD, SOL_SOCKET, SO_REUSEPORT, &reuseOn, sizeof(reuseOn));
+			if (status == -1)
+			{
+				NSString *reason = @"Error enabling port reuse (setsockopt)";
+				err = [self errnoErrorWithReason:reason];
+				
+				LogVerbose(@"close(socketFD)");
+				close(socketFD);
+				return SOCKET_NULL;
+			}
+		}
+		
 		// Bind socket
 		
 		status = bind(socketFD, (const struct sockaddr *)[interfaceAddr bytes], (socklen_t)[interfaceAddr length]);
@@ -5203,6 +5335,32 @@ enum GCDAsyncSocketConfig
 	// as the queue might get released without the block completing.
 }
 
+- (void)writeFileDescriptor:(int)fd
+                     offset:(UInt64)offset
+                     length:(NSUInteger)length
+                withTimeout:(NSTimeInterval)timeout
+                        tag:(long)tag
+{
+	if (fd < 0 || length == 0) return;
+	
+	GCDAsyncFileWritePacket *packet = [[GCDAsyncFileWritePacket alloc] initWithFileDescriptor:fd
+	                                                                                   offset:(off_t)offset
+	                                                                                   length:length
+	                                                                                  timeout:timeout
+	                                                                                      tag:tag];
+	
+	dispatch_async(socketQueue, ^{ @autoreleasepool {
+		
+		LogTrace();
+		
+		if ((flags & kSocketStarted) && !(flags & kForbidReadsWrites))
+		{
+			[writeQueue addObject:packet];
+			[self maybeDequeueWrite];
+		}
+	}});
+}
+
 - (float)progressOfWriteReturningTag:(long *)tagPtr bytesDone:(NSUInteger *)donePtr total:(NSUInteger *)totalPtr
 {
 	__block float result = 0.0F;
@@ -5222,7 +5380,7 @@ enum GCDAsyncSocketConfig
 		else
 		{
 			NSUInteger done = currentWrite->bytesDone;
-			NSUInteger total = [currentWrite->buffer length];
+			NSUInteger total = [currentWrite length];
 			
 			if (tagPtr != NULL)   *tagPtr = currentWrite->tag;
 			if (donePtr != NULL)  *donePtr = done;
@@ -5392,6 +5550,20 @@ enum GCDAsyncSocketConfig
 	NSError *error = nil;
 	size_t bytesWritten = 0;
 	
+	BOOL isFileWrite = [currentWrite isKindOfClass:[GCDAsyncFileWritePacket class]];
+	
+	if ((flags & kSocketSecure) && isFileWrite)
+	{
+		// The file range has to pass through SSL/TLS, so sendfile is of no use here.
+		// Read the range into memory, and write it like any other buffer.
+		
+		if (![(GCDAsyncFileWritePacket *)currentWrite readIntoBuffer])
+		{
+			[self closeWithError:[self errnoErrorWithReason:@"Error in pread() function"]];
+			return;
+		}
+	}
+	
 	if (flags & kSocketSecure)
 	{
 		if ([self usingCFStreamForTLS])
@@ -5567,6 +5739,49 @@ enum GCDAsyncSocketConfig
 			#endif
 		}
 	}
+	else if (isFileWrite)
+	{
+		// 
+		// Writing a file range directly from the kernel's file cache
+		// 
+		
+		int socketFD = (socket4FD == SOCKET_NULL) ? socket6FD : socket4FD;
+		
+		GCDAsyncFileWritePacket *fileWrite = (GCDAsyncFileWritePacket *)currentWrite;
+		
+		off_t fileOffset = fileWrite->fileOffset + (off_t)fileWrite->bytesDone;
+		
+		// Note: sendfile treats a length of zero as "until EOF", but this packet is never empty here.
+		off_t length = (off_t)(fileWrite->fileLength - fileWrite->bytesDone);
+		
+		// On return, length holds the number of bytes sent, even if the call fails with EAGAIN.
+		int result = sendfile(fileWrite->fileFD, socketFD, fileOffset, &length, NULL, 0);
+		LogVerbose(@"sendfile to socket = %d, length = %lld", result, (long long)length);
+		
+		if (result < 0)
+		{
+			if (errno == EWOULDBLOCK || errno == EINTR)
+			{
+				waiting = YES;
+				bytesWritten = (size_t)length;
+			}
+			else
+			{
+				error = [self errnoErrorWithReason:@"Error in sendfile() function"];
+			}
+		}
+		else if (length == 0)
+		{
+			// The file is shorter than the range we were asked to send.
+			// Nothing more will ever arrive, so don't wait on the writeSource forever.
+			
+			error = [self otherError:@"File ended before the requested range could be sent."];
+		}
+		else
+		{
+			bytesWritten = (size_t)length;
+		}
+	}
 	else
 	{
 		// 
@@ -5635,7 +5850,7 @@ enum GCDAsyncSocketConfig
 		LogVerbose(@"currentWrite->bytesDone = %lu", (unsigned long)currentWrite->bytesDone);
 		
 		// Is packet done?
-		done = (currentWrite->bytesDone == [currentWrite->buffer length]);
+		done = (currentWrite->bytesDone == [currentWrite length]);
 	}
 	
 	if (done)
@@ -5685,7 +5900,7 @@ enum GCDAsyncSocketConfig
 	
 	if (error)
 	{
-		[self closeWithError:[self errnoErrorWithReason:@"Error in write() function"]];
+		[self closeWithError:error];
 	}
 	
 	// Do not add any code here without first adding a return statement in the error case above.
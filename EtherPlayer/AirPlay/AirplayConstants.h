@@ -23,6 +23,16 @@ extern const NSUInteger     kAHVideo,
                             kAHFPSAPv2pt5_AES_GCM,
                             kAHPhotoCaching;
 extern const NSUInteger     kAHRequestTagReverse,
-                            kAHRequestTagPlay;
+                            kAHRequestTagReverseEvent;
 extern const NSUInteger     kAHPropertyRequestPlaybackAccess,
                             kAHPropertyRequestPlaybackError;
+extern const NSTimeInterval kAHPlaybackEndTolerance;
+extern const NSTimeInterval kAHUnsettledPollInterval,
+                            kAHSettledPollInterval,
+                            kAHEventFallbackPollInterval;
+extern const NSTimeInterval kAHPositionUpdateInterval,
+                            kAHClockDriftTolerance;
+extern const NSUInteger     kAHClockSettledSamples;
+extern const NSTimeInterval kAHControlConnectTimeout,
+                            kAHControlRequestTimeout;
+extern const NSTimeInterval kAHHealthCheckInterval;
@@ -25,6 +25,24 @@ const NSUInteger    kAHVideo = 0,
                     kAHFPSAPv2pt5_AES_GCM = 12,
                     kAHPhotoCaching = 13;
 const NSUInteger    kAHRequestTagReverse = 1,
-                    kAHRequestTagPlay = 2;
+                    kAHRequestTagReverseEvent = 3;
 const NSUInteger    kAHPropertyRequestPlaybackAccess = 1,
                     kAHPropertyRequestPlaybackError = 2;
+//  playback within this many seconds of the end counts as finished
+const NSTimeInterval kAHPlaybackEndTolerance = 1.5;
+//  poll the receiver this often after a seek or a change of rate, this often once its position
+//  is predictable, or only this often once it's predictable and pushes events over /reverse
+const NSTimeInterval kAHUnsettledPollInterval = 1,
+                     kAHSettledPollInterval = 10,
+                     kAHEventFallbackPollInterval = 15;
+//  move the shown position along this often between samples, and count samples this close
+//  to where it was expected as agreeing with it
+const NSTimeInterval kAHPositionUpdateInterval = 0.5,
+                     kAHClockDriftTolerance = 0.5;
+//  samples in a row that must agree before the position counts as predictable
+const NSUInteger     kAHClockSettledSamples = 2;
+//  seconds to connect the control connection, and for a request sent over it to be answered
+const NSTimeInterval kAHControlConnectTimeout = 2,
+                     kAHControlRequestTimeout = 5;
+//  check the connections to an idle target this often
+const NSTimeInterval kAHHealthCheckInterval = 30;
@@ -0,0 +1,218 @@
+//
+//  AirplayControlConnection.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+private let kAHControlTagResponseHeader = 1
+private let kAHControlTagResponseBody = 2
+
+/**
+ One long-lived HTTP connection to a receiver, which every control request is sent over.
+ 
+ Requests are written as soon as they're resumed, without waiting for the responses to
+ earlier ones, and the receiver answers them in order. Each response is matched to the
+ oldest request still waiting for one.
+ 
+ The connection is made on the first request, and made again on the next request after the
+ receiver closes it. Use it from the main queue, which its completion handlers are called on.
+ */
+class AirplayControlConnection: NSObject {
+    let address: NSData
+    
+    private let socket = GCDAsyncSocket(delegate: nil, delegateQueue: dispatch_get_main_queue())
+    
+    /// Tasks that have been written, oldest first, waiting for their responses.
+    private var pendingTasks = [AirplayControlTask]()
+    
+    /// Header of the response being read, once it has been read.
+    private var responseHeader: CFHTTPMessage?
+    private var readingResponse = false
+    
+    init(address: NSData) {
+        self.address = address
+        
+        super.init()
+        
+        socket.setDelegate(self)
+    }
+    
+    /// Make a task for `request`, which is sent once the task is resumed.
+    func dataTaskWithRequest(request: NSURLRequest, completionHandler: (NSData?, NSURLResponse?, NSError?) -> Void) -> AirplayControlTask {
+        return AirplayControlTask(connection: self, request: request, completionHandler: completionHandler)
+    }
+    
+    /// Close the connection once the requests already written have been answered.
+    func close() {
+        socket.disconnectAfterReadingAndWriting()
+    }
+}
+
+/// A request to send over an `AirplayControlConnection`.
+class AirplayControlTask {
+    let request: NSURLRequest
+    
+    private weak var connection: AirplayControlConnection?
+    private var completionHandler: ((NSData?, NSURLResponse?, NSError?) -> Void)?
+    private var resumed = false
+    
+    private init(connection: AirplayControlConnection, request: NSURLRequest, completionHandler: (NSData?, NSURLResponse?, NSError?) -> Void) {
+        self.connection = connection
+        self.request = request
+        self.completionHandler = completionHandler
+    }
+    
+    func resume() {
+        guard !resumed else {
+            return
+        }
+        
+        resumed = true
+        connection?.sendTask(self)
+    }
+    
+    /// Don't call the completion handler. A request that has been written is still answered,
+    /// and its response is read and dropped to keep later responses in step.
+    func cancel() {
+        completionHandler = nil
+    }
+    
+    private func complete(data: NSData?, response: NSURLResponse?, error: NSError?) {
+        let completionHandler = self.completionHandler
+        self.completionHandler = nil
+        
+        completionHandler?(data, response, error)
+    }
+}
+
+private extension AirplayControlConnection {
+    func sendTask(task: AirplayControlTask) {
+        guard let data = serializedRequest(task.request) else {
+            task.complete(nil, response: nil, error: NSError(domain: NSURLErrorDomain, code: NSURLErrorBadURL, userInfo: nil))
+            return
+        }
+        
+        if socket.isDisconnected() {
+            do {
+                try socket.connectToAddress(address, withTimeout: kAHControlConnectTimeout)
+            } catch {
+                print("Error connecting control connection: \(error)")
+                task.complete(nil, response: nil, error: error as NSError)
+                return
+            }
+        }
+        
+        //  writes and reads queued while connecting go out once connected
+        pendingTasks.append(task)
+        socket.writeData(data, withTimeout: kAHControlRequestTimeout, tag: 0)
+        readNextResponse()
+    }
+    
+    func readNextResponse() {
+        guard !readingResponse && !pendingTasks.isEmpty else {
+            return
+        }
+        
+        readingResponse = true
+        socket.readDataToData("\r\n\r\n".dataUsingEncoding(NSUTF8StringEncoding), withTimeout: kAHControlRequestTimeout, tag: kAHControlTagResponseHeader)
+    }
+    
+    func completeResponse(body: NSData) {
+        let header = responseHeader
+        responseHeader = nil
+        readingResponse = false
+        
+        guard !pendingTasks.isEmpty else {
+            print("Control connection read a response without a request")
+            return
+        }
+        
+        let task = pendingTasks.removeFirst()
+        let response = header.flatMap { httpResponse($0, url: task.request.URL) }
+        
+        task.complete(body, response: response, error: nil)
+        readNextResponse()
+    }
+    
+    func serializedRequest(request: NSURLRequest) -> NSData? {
+        guard let url = request.URL?.absoluteURL, host = url.host else {
+            return nil
+        }
+        
+        let body = request.HTTPBody ?? NSData()
+        let method = request.HTTPMethod ?? "GET"
+        let message = CFHTTPMessageCreateRequest(kCFAllocatorDefault, method as CFStringRef, url as CFURLRef, kCFHTTPVersion1_1).takeRetainedValue()
+        
+        for (field, value) in request.allHTTPHeaderFields ?? [:] {
+            CFHTTPMessageSetHeaderFieldValue(message, field as CFStringRef, value as CFStringRef)
+        }
+        
+        let hostValue = url.port.map { "\(host):\($0)" } ?? host
+        CFHTTPMessageSetHeaderFieldValue(message, "Host", hostValue as CFStringRef)
+        CFHTTPMessageSetHeaderFieldValue(message, "Content-Length", "\(body.length)" as CFStringRef)
+        CFHTTPMessageSetBody(message, body as CFDataRef)
+        
+        guard let serializedMessage = CFHTTPMessageCopySerializedMessage(message)?.takeRetainedValue() else {
+            return nil
+        }
+        
+        return serializedMessage as NSData
+    }
+    
+    func httpResponse(header: CFHTTPMessage, url: NSURL?) -> NSHTTPURLResponse? {
+        guard let url = url else {
+            return nil
+        }
+        
+        let statusCode = CFHTTPMessageGetResponseStatusCode(header)
+        let headerFields = CFHTTPMessageCopyAllHeaderFields(header)?.takeRetainedValue() as NSDictionary? as? [String:String]
+        
+        return NSHTTPURLResponse(URL: url, statusCode: statusCode, HTTPVersion: kCFHTTPVersion1_1 as String, headerFields: headerFields)
+    }
+}
+
+extension AirplayControlConnection: GCDAsyncSocketDelegate {
+    func socket(sock: GCDAsyncSocket!, didReadData data: NSData!, withTag tag: Int) {
+        switch tag {
+        case kAHControlTagResponseHeader:
+            let header = CFHTTPMessageCreateEmpty(kCFAllocatorDefault, false).takeRetainedValue()
+            CFHTTPMessageAppendBytes(header, UnsafePointer<UInt8>(data.bytes), data.length)
+            
+            let contentLength = CFHTTPMessageCopyHeaderFieldValue(header, "Content-Length")?.takeRetainedValue()
+            let bodyLength = contentLength.flatMap { Int($0 as String) } ?? 0
+            
+            responseHeader = header
+            
+            if bodyLength > 0 {
+                socket.readDataToLength(UInt(bodyLength), withTimeout: kAHControlRequestTimeout, tag: kAHControlTagResponseBody)
+            } else {
+                completeResponse(NSData())
+            }
+        case kAHControlTagResponseBody:
+            completeResponse(data)
+        default:
+            break
+        }
+    }
+    
+    func socketDidDisconnect(sock: GCDAsyncSocket!, withError err: NSError!) {
+        //  requests that weren't answered won't be now, and the next one reconnects
+        let failedTasks = pendingTasks
+        pendingTasks = []
+        responseHeader = nil
+        readingResponse = false
+        
+        if !failedTasks.isEmpty {
+            print("Control connection closed with \(failedTasks.count) requests unanswered: \(err)")
+        }
+        
+        let error = err ?? NSError(domain: NSURLErrorDomain, code: NSURLErrorNetworkConnectionLost, userInfo: nil)
+        for task in failedTasks {
+            task.complete(nil, response: nil, error: error)
+        }
+    }
+}
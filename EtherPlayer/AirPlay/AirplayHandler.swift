@@ -14,7 +14,6 @@ private typealias ServerInfoState = AirplayState<ServerInfoRequester>
 class AirplayHandler: NSObject {
     var delegate: AirplayHandlerDelegate?
     var videoConverter: VideoConverter!
-    var urlSession: NSURLSession = NSURLSession.sharedSession()
     
     // Initialize and update these together
     var sessionID: String = NSUUID().UUIDString
@@ -35,18 +34,31 @@ class AirplayHandler: NSObject {
 	private var prevInfoRequest = "/scrub"
 	private var responseData = NSMutableData()
     private var infoTimer: NSTimer?
+    private var positionTimer: NSTimer?
+    private var healthCheckTimer: NSTimer?
     private var serverCapabilities: AirplayServerInfo?
     
     private let reverseSocket = GCDAsyncSocket(delegate: nil, delegateQueue: dispatch_get_main_queue())
-    private let mainSocket = GCDAsyncSocket(delegate: nil, delegateQueue: dispatch_get_main_queue())
+    /// Every request but /reverse goes over this, one connection per target service.
+    private var controlConnection: AirplayControlConnection?
+    private lazy var reverseEventReader: ReverseEventReader = {
+        let reader = ReverseEventReader(socket: self.reverseSocket)
+        reader.delegate = self
+        return reader
+    }()
     
 	var operationQueue = NSOperationQueue.mainQueue()
 	private var airplaying = false
 	private var paused = true
     
 	private var playbackPosition: Double = 0
+    private let playbackClock = PlaybackClock()
     private var playbackDuration: Double = 0
     private var playbackURL: String = ""
+    private var reportedPlaybackFinished = false
+    
+    /// `true` once /reverse has been upgraded for `sessionID`, until its connection closes.
+    private var reverseChannelReady = false
     
     /**
      Keep a strong reference to the server info state, since it makes network
@@ -54,12 +66,13 @@ class AirplayHandler: NSObject {
      */
     private var serverInfoState: ServerInfoState?
     private var stateMachine = AirplayStateMachine(states: [])
+    private var playbackInfoRequester: PlaybackInfoRequester?
+    private var scrubRequester: ScrubRequester?
     
     override init() {
         super.init()
         
         reverseSocket.setDelegate(self)
-        mainSocket.setDelegate(self)
         
 //        operationQueue.name = "Connection Queue"
     }
@@ -69,7 +82,9 @@ class AirplayHandler: NSObject {
         playbackInfoRequester.delegate = self
         playbackInfoRequester.requestCustomizer = self
         
-        let playingRequester = PlayingRequester(httpFilePath: playbackURL, socket: mainSocket, targetAddress: targetServiceAddress)
+        let playingRequester = PlayingRequester(httpFilePath: playbackURL)
+        playingRequester.delegate = self
+        
         let reverseRequester = ReverseRequester(socket: reverseSocket, targetAddress: targetServiceAddress)
         
         let scrubRequester = ScrubRequester()
@@ -80,6 +95,9 @@ class AirplayHandler: NSObject {
         stopRequester.delegate = self
         stopRequester.requestCustomizer = self
         
+        self.playbackInfoRequester = playbackInfoRequester
+        self.scrubRequester = scrubRequester
+        
         let states = [
             generateState(playbackInfoRequester),
             generateState(playingRequester),
@@ -93,7 +111,7 @@ class AirplayHandler: NSObject {
     
     private func generateState<RequesterType: AirplayRequester>(requester: RequesterType) -> AirplayState<RequesterType> {
         let targetBaseURL = self.targetBaseURL!
-        return AirplayState(baseURL: targetBaseURL, sessionID: sessionID, requester: requester)
+        return AirplayState(baseURL: targetBaseURL, sessionID: sessionID, requester: requester, connection: controlConnection!)
     }
     
     private func internalSetTargetService(targetService: NSNetService?) {
@@ -101,6 +119,13 @@ class AirplayHandler: NSObject {
         
         stateMachine.enterState(AirplayStopState.self)
         
+        controlConnection?.close()
+        controlConnection = nil
+        healthCheckTimer?.invalidate()
+        reverseEventReader.reset()
+        reverseSocket.disconnect()
+        reverseChannelReady = false
+        
         guard let targetService = targetService else {
             return
         }
@@ -159,12 +184,23 @@ class AirplayHandler: NSObject {
             return
         }
         
+        let controlConnection = AirplayControlConnection(address: sockData)
+        self.controlConnection = controlConnection
+        
         let requester = ServerInfoRequester()
         requester.delegate = self
         requester.requestCustomizer = self
-        let serverInfoState = AirplayState(baseURL: targetBaseURL, sessionID: sessionID, requester: requester)
+        let serverInfoState = AirplayState(baseURL: targetBaseURL, sessionID: sessionID, requester: requester, connection: controlConnection)
         serverInfoState.didEnterWithPreviousState(nil)
         self.serverInfoState = serverInfoState
+        
+        //  get /reverse ready now, so /play is all that's left once there's something to play
+        prewarmReceiverSession()
+        healthCheckTimer = NSTimer.scheduledTimerWithTimeInterval(kAHHealthCheckInterval,
+                                                                  target: self,
+                                                                  selector: #selector(AirplayHandler.healthCheckTimerFired),
+                                                                  userInfo: nil,
+                                                                  repeats: true)
     }
 }
 
@@ -177,6 +213,9 @@ extension AirplayHandler {
         paused = !paused
         changePlaybackStatus()
         delegate?.setPaused(paused)
+        
+        playbackClock.setRate(paused ? 0 : 1)
+        updatePolling()
     }
     
     func startAirplay(playbackURL: String, playbackDuration: Double) {
@@ -186,9 +225,20 @@ extension AirplayHandler {
         
         self.playbackURL = playbackURL
         self.playbackDuration = playbackDuration
+        reportedPlaybackFinished = false
+        
+        //  a /reverse connection that's already made or being made has a session we can use
+        if !reverseChannelReady && reverseSocket.isDisconnected() {
+            sessionID = NSUUID().UUIDString
+        }
+        
         createAfterServerInfoStateMachine(targetBaseURL!)
-        sessionID = NSUUID().UUIDString
-        stateMachine.enterState(AirplayReverseState.self)
+        
+        if reverseChannelReady {
+            stateMachine.enterState(AirplayPlayingState.self)
+        } else {
+            stateMachine.enterState(AirplayReverseState.self)
+        }
     }
     
     func setCommonHeadersForRequest(request: NSMutableURLRequest) {
@@ -220,15 +270,121 @@ extension AirplayHandler {
         
         setCommonHeadersForRequest(request)
         
-        let task = urlSession.dataTaskWithRequest(request) { (data, response, error) in
+        let task = controlConnection?.dataTaskWithRequest(request) { (data, response, error) in
             // empty
         }
         
-        task.resume()
+        task?.resume()
+    }
+    
+    /// Seek to `position` in the input. Seeks made faster than the receiver answers them are collapsed into the latest.
+    func seekToPosition(position: Double) {
+        guard airplaying, let targetBaseURL = targetBaseURL, controlConnection = controlConnection else {
+            return
+        }
+        
+        //  the answer to a position request in flight would be from before the seek
+        playbackInfoRequester?.cancelRequest()
+        scrubRequester?.seekToPosition(position, baseURL: targetBaseURL, connection: controlConnection)
     }
 }
 
 private extension AirplayHandler {
+    /// Start a session with the target by connecting and upgrading /reverse, unless that's already done or under way.
+    func prewarmReceiverSession() {
+        guard let targetBaseURL = targetBaseURL, controlConnection = controlConnection where !airplaying && reverseSocket.isDisconnected() else {
+            return
+        }
+        
+        sessionID = NSUUID().UUIDString
+        
+        let reverseRequester = ReverseRequester(socket: reverseSocket, targetAddress: targetServiceAddress)
+        let reverseState = AirplayState(baseURL: targetBaseURL, sessionID: sessionID, requester: reverseRequester, connection: controlConnection)
+        reverseState.didEnterWithPreviousState(nil)
+    }
+    
+    ///  keeps the connections to an idle target open, and makes them again if they closed
+    @objc func healthCheckTimerFired() {
+        guard !airplaying else {
+            return
+        }
+        
+        prewarmReceiverSession()
+        
+        let url = NSURL(string: "/server-info", relativeToURL: targetBaseURL)!
+        let request = NSMutableURLRequest(URL: url)
+        setCommonHeadersForRequest(request)
+        
+        let task = controlConnection?.dataTaskWithRequest(request) { (data, response, error) in
+            if let error = error {
+                print("Control connection health check failed: \(error)")
+            }
+        }
+        
+        task?.resume()
+    }
+    
+    /// Poll as often as the playback clock needs, and less often while the receiver pushes events to us.
+    func updatePolling() {
+        guard airplaying else {
+            return
+        }
+        
+        let settledInterval = reverseEventReader.reading ? kAHEventFallbackPollInterval : kAHSettledPollInterval
+        schedulePolling(playbackClock.pollInterval(settledInterval))
+    }
+    
+    /// Pass on a position sample that the playback clock was just corrected with.
+    func playbackClockDidSample() {
+        //  the receiver's position is in the output, which may have skipped ahead of the input
+        playbackPosition = videoConverter.mediaPositionForPlaybackPosition(playbackClock.position)
+        videoConverter.playbackPositionDidChange(playbackPosition)
+        
+        reportPlaybackPosition()
+        
+        //  the receiver holds the last frame at the end, rather than stopping.
+        //  only a sample says it got there, the clock runs on past a stall.
+        let finished = playbackDuration > 0 && playbackPosition >= playbackDuration - kAHPlaybackEndTolerance
+        if airplaying && finished && !reportedPlaybackFinished {
+            reportedPlaybackFinished = true
+            delegate?.playbackFinished()
+        }
+        
+        updatePolling()
+    }
+    
+    func reportPlaybackPosition() {
+        if playbackDuration > 0 {
+            playbackPosition = min(playbackPosition, playbackDuration)
+        }
+        
+        delegate?.positionUpdated(playbackPosition)
+    }
+    
+    ///  moves the position along between samples
+    @objc func positionTimerFired() {
+        guard airplaying && !paused else {
+            return
+        }
+        
+        playbackPosition = videoConverter.mediaPositionForPlaybackPosition(playbackClock.position)
+        reportPlaybackPosition()
+    }
+    
+    /// Poll every `interval` seconds from now on, replacing any earlier polling.
+    func schedulePolling(interval: NSTimeInterval) {
+        guard infoTimer?.timeInterval != interval || infoTimer?.valid != true else {
+            return
+        }
+        
+        infoTimer?.invalidate()
+        infoTimer = NSTimer.scheduledTimerWithTimeInterval(interval,
+                                                           target: self,
+                                                           selector: #selector(AirplayHandler.infoTimerFired),
+                                                           userInfo: nil,
+                                                           repeats: true)
+    }
+    
     ///  alternates /scrub and /playback-info
     @objc func infoTimerFired() {
         guard airplaying else {
@@ -259,7 +415,7 @@ private extension AirplayHandler {
         setCommonHeadersForRequest(request)
         request.setValue("application/x-apple-binary-plist", forHTTPHeaderField: "Content-Type")
         
-        let task = urlSession.dataTaskWithRequest(request) { (data, response, error) in
+        let task = controlConnection?.dataTaskWithRequest(request) { (data, response, error) in
             //  get the PLIST from the response and log it
             guard let data = data else {
                 return
@@ -286,7 +442,7 @@ private extension AirplayHandler {
             print("\(requestType): \(propertyPlist)")
         }
         
-        task.resume()
+        task?.resume()
     }
 }
 
@@ -322,15 +478,36 @@ extension AirplayHandler: GCDAsyncSocketDelegate {
         case kAHRequestTagReverse:
             //  /reverse request data written
             break
-        case kAHRequestTagPlay:
-            //  /play request data written
-            airplaying = true
         default:
             break
         }
     }
     
+    func socketDidDisconnect(sock: GCDAsyncSocket!, withError err: NSError!) {
+        guard sock === reverseSocket else {
+            return
+        }
+        
+        reverseChannelReady = false
+        
+        let wasReading = reverseEventReader.reading
+        reverseEventReader.reset()
+        
+        guard wasReading else {
+            return
+        }
+        
+        //  no more events are coming, so fall back to polling more often
+        print("/reverse connection closed: \(err)")
+        updatePolling()
+    }
+    
     func socket(sock: GCDAsyncSocket!, didReadData data: NSData!, withTag tag: Int) {
+        guard UInt(tag) != kAHRequestTagReverseEvent else {
+            reverseEventReader.socketDidReadData(data)
+            return
+        }
+        
         let replyString = String(data: data, encoding: NSUTF8StringEncoding)!
         
         print("socket:didReadData:withTag: data:\r\n%@", replyString)
@@ -342,39 +519,33 @@ extension AirplayHandler: GCDAsyncSocketDelegate {
             //  /reverse request reply received and read
             range = replyString.rangeOfString("HTTP/1.1 101 Switching Protocols")
             
-            if range == nil {
-                //  a /reverse reply after we started playback, this should contain
-                //  any playback info that the server wants to send
+            //  anything read after the upgrade is an event, and tagged as one
+            if range != nil {
+                //  the first /reverse reply, now we can start playback,
+                //  and listen for the events the receiver pushes from here on
+                reverseChannelReady = true
+                reverseEventReader.start()
                 
-                //  TODO: does this ever occur?
-                print("later /reverse data")
+                //  start playback now if it was waiting on us, rather than prewarmed
+                if stateMachine.currentState is AirplayReverseState {
+                    stateMachine.enterState(AirplayPlayingState.self)
+                }
             } else {
-                //  the first /reverse reply, now we should start playback
-                stateMachine.enterState(AirplayPlayingState.self)
-                reverseSocket.readDataWithTimeout(100, tag: Int(kAHRequestTagReverse))
-            }
-            
-            print("read data for /reverse reply")
-        case kAHRequestTagPlay:
-            //  /play request reply received and read
-            range = replyString.rangeOfString("HTTP/1.1 200 OK")
-            
-            if let _ = range {
-                airplaying = true
-                paused = false
-                delegate?.setPaused(paused)
+                //  the receiver turned the upgrade down. drop the connection, so the next
+                //  playback makes a new one, and let playback that was waiting on it know.
+                reverseSocket.disconnect()
                 
-                // TODO: Integrate me more tightly with our state machine?
-                delegate?.durationUpdated(playbackDuration)
-                
-                infoTimer = NSTimer.scheduledTimerWithTimeInterval(3,
-                                                                   target: self,
-                                                                   selector: #selector(AirplayHandler.infoTimerFired),
-                                                                   userInfo: nil,
-                                                                   repeats: true)
+                if stateMachine.currentState is AirplayReverseState {
+                    let userInfo = [NSLocalizedDescriptionKey : "Target AirPlay server refused the /reverse connection."]
+                    
+                    let bundleIdentifier = NSBundle.mainBundle().bundleIdentifier!
+                    let error = NSError(domain: bundleIdentifier, code: 101, userInfo: userInfo)
+                    
+                    stoppedWithError(error)
+                }
             }
             
-            print("read data for /play reply")
+            print("read data for /reverse reply")
         default:
             print("read data for unknown reply")
         }
@@ -387,13 +558,36 @@ extension AirplayHandler: AirplayRequestCustomizer {
     }
 }
 
-extension AirplayHandler: PlaybackInfoRequesterDelegate {
-    func didUpdatePlaybackStatus(paused paused: Bool, playbackPosition: Double) {
-        self.paused = paused
-        self.playbackPosition = playbackPosition
-        
-        delegate?.positionUpdated(playbackPosition)
+extension AirplayHandler: PlayingRequesterDelegate {
+    func didStartPlayback() {
+        airplaying = true
+        paused = false
         delegate?.setPaused(paused)
+        
+        // TODO: Integrate me more tightly with our state machine?
+        delegate?.durationUpdated(playbackDuration)
+        
+        playbackClock.reset(0, rate: 1)
+        updatePolling()
+        
+        positionTimer?.invalidate()
+        positionTimer = NSTimer.scheduledTimerWithTimeInterval(kAHPositionUpdateInterval,
+                                                               target: self,
+                                                               selector: #selector(AirplayHandler.positionTimerFired),
+                                                               userInfo: nil,
+                                                               repeats: true)
+    }
+}
+
+extension AirplayHandler: PlaybackInfoRequesterDelegate {
+    func didUpdatePlaybackStatus(paused paused: Bool, playbackPosition: Double, rate: Double) {
+        dispatch_async(dispatch_get_main_queue()) {
+            self.paused = paused
+            self.delegate?.setPaused(paused)
+            
+            self.playbackClock.addSample(playbackPosition, rate: rate)
+            self.playbackClockDidSample()
+        }
     }
     
     func didErrorGettingPlaybackStatus() {
@@ -403,8 +597,56 @@ extension AirplayHandler: PlaybackInfoRequesterDelegate {
 
 extension AirplayHandler: ScrubRequesterDelegate {
     func playbackPositionUpdated(playbackPosition: Double) {
-        self.playbackPosition = playbackPosition
-        delegate?.positionUpdated(playbackPosition)
+        dispatch_async(dispatch_get_main_queue()) {
+            //  /scrub doesn't report the rate, so keep the one we have
+            self.playbackClock.addSample(playbackPosition, rate: nil)
+            self.playbackClockDidSample()
+        }
+    }
+    
+    ///  skips the conversion ahead first if it isn't at `position` yet
+    func requester(requester: ScrubRequester, playbackPositionForSeekToPosition position: Double) -> Double {
+        let scrubPosition = videoConverter.seekToPosition(position)
+        
+        playbackClock.seek(scrubPosition)
+        updatePolling()
+        
+        return scrubPosition
+    }
+}
+
+extension AirplayHandler: ReverseEventReaderDelegate {
+    func eventReader(reader: ReverseEventReader, didReceiveEvent event: ReverseEvent) {
+        guard airplaying else {
+            return
+        }
+        
+        if let paused = event.paused where paused != self.paused {
+            self.paused = paused
+            delegate?.setPaused(paused)
+        }
+        
+        if let rate = event.rate ?? event.paused.map({ $0 ? 0 : 1 }) {
+            playbackClock.setRate(rate)
+        }
+        
+        //  events keep us up to date, so polling only needs to catch what they don't carry
+        if let position = event.position {
+            playbackClock.addSample(position, rate: event.rate)
+            playbackClockDidSample()
+        } else {
+            updatePolling()
+        }
+        
+        //  the receiver stops by itself at the end, which our estimate may fall a little short of
+        let nearEnd = playbackDuration > 0 && playbackPosition >= playbackDuration - kAHPlaybackEndTolerance - kAHClockDriftTolerance
+        if event.stopped && nearEnd && !reportedPlaybackFinished {
+            reportedPlaybackFinished = true
+            delegate?.playbackFinished()
+        } else if event.position == nil {
+            //  the position moves with the state, so bring it up to date now
+            infoTimerFired()
+        }
     }
 }
 
@@ -424,6 +666,8 @@ extension AirplayHandler: StopRequesterDelegate {
         paused = false
         airplaying = false
         infoTimer?.invalidate()
+        positionTimer?.invalidate()
+        playbackClock.reset(0, rate: 0)
         
         playbackPosition = 0
         delegate?.positionUpdated(playbackPosition)
@@ -437,4 +681,5 @@ protocol AirplayHandlerDelegate: NSObjectProtocol {
     func positionUpdated(position: Double)
     func durationUpdated(duration: Double)
     func airplayStoppedWithError(error: NSError?)
+    func playbackFinished()
 }
@@ -41,7 +41,8 @@ private enum State {
     
     static func validTransition(leavingStateOfClass: AnyClass?, forStateOfClass: AnyClass) -> Bool {
         guard let leavingClass = leavingStateOfClass else {
-            return forStateOfClass == AirplayReverseState.self
+            //  straight to /play when /reverse was upgraded beforehand
+            return forStateOfClass == AirplayReverseState.self || forStateOfClass == AirplayPlayingState.self
         }
         
         let targetStateIsStop = forStateOfClass == AirplayStopState.self
@@ -79,16 +80,17 @@ class AirplayState<Requester: AirplayRequester>: GKState {
     let baseURL: NSURL
     let sessionID: String
     let requester: Requester
-    var urlSession: NSURLSession = NSURLSession.sharedSession()
+    let connection: AirplayControlConnection
     
-    init(baseURL: NSURL, sessionID: String, requester: Requester) {
+    init(baseURL: NSURL, sessionID: String, requester: Requester, connection: AirplayControlConnection) {
         self.baseURL = baseURL
         self.sessionID = sessionID
         self.requester = requester
+        self.connection = connection
     }
     
     override func didEnterWithPreviousState(previousState: GKState?) {
-        requester.performRequest(baseURL, sessionID: sessionID, urlSession: urlSession)
+        requester.performRequest(baseURL, sessionID: sessionID, connection: connection)
     }
     
     override func isValidNextState(stateClass: AnyClass) -> Bool {
@@ -97,7 +99,7 @@ class AirplayState<Requester: AirplayRequester>: GKState {
 }
 
 protocol AirplayRequester {
-    func performRequest(baseURL: NSURL, sessionID: String, urlSession: NSURLSession)
+    func performRequest(baseURL: NSURL, sessionID: String, connection: AirplayControlConnection)
     func cancelRequest()
 }
 
@@ -0,0 +1,84 @@
+//
+//  PlaybackClock.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/**
+ Estimates the receiver's playback position between the samples it reports,
+ by running on from the latest sample at the latest rate.
+ 
+ Each sample corrects the estimate, and the clock counts itself settled once
+ `kAHClockSettledSamples` samples in a row have agreed with it to within `kAHClockDriftTolerance`.
+ A seek or a change of rate unsettles it, since those are when the receiver is least predictable.
+ 
+ Positions are in the receiver's output, in seconds.
+ */
+class PlaybackClock {
+    private(set) var rate: Double = 0
+    
+    private var anchorPosition: Double = 0
+    private var anchorDate = NSDate()
+    private var agreeingSamples: UInt = 0
+    
+    var position: Double {
+        return anchorPosition + rate * NSDate().timeIntervalSinceDate(anchorDate)
+    }
+    
+    var settled: Bool {
+        return agreeingSamples >= kAHClockSettledSamples
+    }
+    
+    func reset(position: Double, rate: Double) {
+        self.rate = rate
+        anchor(position)
+        agreeingSamples = 0
+    }
+    
+    func seek(position: Double) {
+        anchor(position)
+        agreeingSamples = 0
+    }
+    
+    func setRate(rate: Double) {
+        guard rate != self.rate else {
+            return
+        }
+        
+        anchor(position)
+        self.rate = rate
+        agreeingSamples = 0
+    }
+    
+    /// Correct the estimate with a position the receiver reported, and its rate if it reported one.
+    func addSample(position: Double, rate: Double?) {
+        let drift = position - self.position
+        
+        if let rate = rate where rate != self.rate {
+            self.rate = rate
+            agreeingSamples = 0
+        } else if abs(drift) <= kAHClockDriftTolerance {
+            agreeingSamples += 1
+        } else {
+            agreeingSamples = 0
+        }
+        
+        anchor(position)
+    }
+    
+    /// How long to wait for the next sample: not long while unsettled, `settledInterval` otherwise.
+    func pollInterval(settledInterval: NSTimeInterval) -> NSTimeInterval {
+        return settled ? settledInterval : kAHUnsettledPollInterval
+    }
+}
+
+private extension PlaybackClock {
+    func anchor(position: Double) {
+        anchorPosition = position
+        anchorDate = NSDate()
+    }
+}
@@ -13,9 +13,9 @@ class PlaybackInfoRequester: AirplayRequester {
     
     weak var delegate: PlaybackInfoRequesterDelegate?
     var requestCustomizer: AirplayRequestCustomizer?
-    var requestTask: NSURLSessionTask?
+    var requestTask: AirplayControlTask?
     
-    func performRequest(baseURL: NSURL, sessionID: String, urlSession: NSURLSession) {
+    func performRequest(baseURL: NSURL, sessionID: String, connection: AirplayControlConnection) {
         guard requestTask == nil else {
             print("\(relativeURL) request already in flight, not performing another one.")
             return
@@ -25,7 +25,7 @@ class PlaybackInfoRequester: AirplayRequester {
         let request = NSMutableURLRequest(URL: url)
         requestCustomizer?.requester(self, willPerformRequest: request)
         
-        let task = urlSession.dataTaskWithRequest(request, completionHandler: { [weak self] (data, response, error) in
+        let task = connection.dataTaskWithRequest(request, completionHandler: { [weak self] (data, response, error) in
             //  update our playback status and position after /playback-info
             
             guard let strongSelf = self else {
@@ -77,11 +77,11 @@ class PlaybackInfoRequester: AirplayRequester {
                 //  [self stoppedWithError:error]
             } else if let position = playbackInfo["position"] as? String {
                 let playbackPosition = Double(position) ?? 0
-                let rateString = playbackInfo["rate"] as? String
-                let rate = rateString.map { Double($0) } ?? 0
+                let rateValue = playbackInfo["rate"]
+                let rate = (rateValue as? NSNumber)?.doubleValue ?? (rateValue as? String).flatMap { Double($0) } ?? 0
                 let paused = rate < 0.5 ? true : false
                 
-                strongSelf.delegate?.didUpdatePlaybackStatus(paused: paused, playbackPosition: playbackPosition)
+                strongSelf.delegate?.didUpdatePlaybackStatus(paused: paused, playbackPosition: playbackPosition, rate: rate)
             } else {
                 strongSelf.delegate?.didErrorGettingPlaybackStatus()
             }
@@ -98,6 +98,6 @@ class PlaybackInfoRequester: AirplayRequester {
 }
 
 protocol PlaybackInfoRequesterDelegate: class {
-    func didUpdatePlaybackStatus(paused paused: Bool, playbackPosition: Double)
+    func didUpdatePlaybackStatus(paused paused: Bool, playbackPosition: Double, rate: Double)
     func didErrorGettingPlaybackStatus()
 }
@@ -10,16 +10,16 @@ import Cocoa
 
 class PlayingRequester: AirplayRequester {
     let httpFilePath: String
-    let socket: GCDAsyncSocket
-    let targetAddress: NSData
     
-    init(httpFilePath: String, socket: GCDAsyncSocket, targetAddress: NSData) {
+    weak var delegate: PlayingRequesterDelegate?
+    
+    private var requestTask: AirplayControlTask?
+    
+    init(httpFilePath: String) {
         self.httpFilePath = httpFilePath
-        self.socket = socket
-        self.targetAddress = targetAddress
     }
     
-    func performRequest(baseURL: NSURL, sessionID: String, urlSession: NSURLSession) {
+    func performRequest(baseURL: NSURL, sessionID: String, connection: AirplayControlConnection) {
         NSLog("/play")
         
         let appName = NSBundle.mainBundle().objectForInfoDictionaryKey("CFBundleName") as! String
@@ -36,31 +36,40 @@ class PlayingRequester: AirplayRequester {
             return
         }
         
-        let dataLength = "\(outData.length)"
-        
-        let bodyString: CFString = ""
-        let requestMethod: CFString = "POST"
-        let myURL = baseURL.URLByAppendingPathComponent("play") as CFURLRef
-        let myRequest = CFHTTPMessageCreateRequest(kCFAllocatorDefault, requestMethod, myURL, kCFHTTPVersion1_1).takeUnretainedValue()
+        let url = baseURL.URLByAppendingPathComponent("play")
+        let request = NSMutableURLRequest(URL: url)
+        request.HTTPMethod = "POST"
+        request.HTTPBody = outData
+        request.setValue(appName, forHTTPHeaderField: "User-Agent")
+        request.setValue("application/x-apple-binary-plist", forHTTPHeaderField: "Content-Type")
+        request.setValue(sessionID, forHTTPHeaderField: "X-Apple-Session-ID")
         
-        CFHTTPMessageSetHeaderFieldValue(myRequest, "User-Agent", appName)
-        CFHTTPMessageSetHeaderFieldValue(myRequest, "Content-Length", dataLength)
-        CFHTTPMessageSetHeaderFieldValue(myRequest, "Content-Type", "application/x-apple-binary-plist")
-        CFHTTPMessageSetHeaderFieldValue(myRequest, "X-Apple-Session-ID", sessionID)
-        let mySerializedRequest = CFHTTPMessageCopySerializedMessage(myRequest)?.takeUnretainedValue()
-        let data = NSMutableData(data: mySerializedRequest!)
-        data.appendData(outData)
-        
-        do {
-            try socket.connectToAddress(targetAddress)
-            socket.writeData(data, withTimeout: 1, tag: Int(kAHRequestTagPlay))
-            socket.readDataToData("\r\n\r\n".dataUsingEncoding(NSUTF8StringEncoding), withTimeout: 2, tag: Int(kAHRequestTagPlay))
-        } catch {
-            print("Error connecting main socket for /play request: \(error)")
+        let task = connection.dataTaskWithRequest(request) { [weak self] (data, response, error) in
+            //  /play request reply received and read
+            guard let strongSelf = self else {
+                return
+            }
+            
+            strongSelf.requestTask = nil
+            
+            guard let response = response as? NSHTTPURLResponse where response.statusCode == 200 else {
+                print("Error starting playback with /play: \(error)")
+                return
+            }
+            
+            strongSelf.delegate?.didStartPlayback()
         }
+        
+        requestTask = task
+        task.resume()
     }
     
     func cancelRequest() {
-        // empty
+        requestTask?.cancel()
+        requestTask = nil
     }
 }
+
+protocol PlayingRequesterDelegate: class {
+    func didStartPlayback()
+}
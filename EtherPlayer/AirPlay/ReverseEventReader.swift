@@ -0,0 +1,193 @@
+//
+//  ReverseEventReader.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// A playback event the receiver pushed over the /reverse connection.
+struct ReverseEvent {
+    /// "loading", "playing", "paused" or "stopped"
+    let state: String?
+    let rate: Double?
+    let position: Double?
+    
+    var paused: Bool? {
+        if let rate = rate {
+            return rate < 0.5
+        }
+        
+        switch state {
+        case "playing"?:
+            return false
+        case "paused"?, "stopped"?:
+            return true
+        default:
+            return nil
+        }
+    }
+    
+    var stopped: Bool {
+        return state == "stopped"
+    }
+}
+
+/**
+ Reads the requests the receiver makes of us over the /reverse connection,
+ once it has been upgraded to PTTH, and answers each of them.
+ 
+ Each request is read as its header, then its body of `Content-Length` bytes.
+ The owner of the socket must pass on reads tagged `kAHRequestTagReverseEvent`.
+ 
+ Once started, requests are read and answered until `reset()`, even while stopped,
+ as the receiver waits for each answer before sending anything else. Only their events aren't passed on.
+ */
+class ReverseEventReader {
+    let socket: GCDAsyncSocket
+    
+    weak var delegate: ReverseEventReaderDelegate?
+    
+    /// `true` while events are passed on to the delegate.
+    private(set) var reading = false
+    
+    /// `true` while a read of the next request is pending on the socket.
+    private var readingRequests = false
+    
+    /// Length of the body of the request being read, or `nil` while reading a header.
+    private var pendingBodyLength: Int?
+    
+    init(socket: GCDAsyncSocket) {
+        self.socket = socket
+    }
+    
+    func start() {
+        reading = true
+        
+        //  a read may still be pending from before a stop
+        guard !readingRequests else {
+            return
+        }
+        
+        readingRequests = true
+        pendingBodyLength = nil
+        readHeader()
+    }
+    
+    func stop() {
+        reading = false
+    }
+    
+    /// Stop, and forget any read in progress, once the socket has disconnected.
+    func reset() {
+        reading = false
+        readingRequests = false
+        pendingBodyLength = nil
+    }
+    
+    func socketDidReadData(data: NSData) {
+        guard readingRequests else {
+            return
+        }
+        
+        if let bodyLength = pendingBodyLength {
+            pendingBodyLength = nil
+            
+            assert(data.length == bodyLength)
+            
+            handleBody(data)
+            readHeader()
+            return
+        }
+        
+        let header = String(data: data, encoding: NSUTF8StringEncoding) ?? ""
+        let bodyLength = ReverseEventReader.contentLengthOfHeader(header)
+        
+        if bodyLength > 0 {
+            pendingBodyLength = bodyLength
+            socket.readDataToLength(UInt(bodyLength), withTimeout: -1, tag: Int(kAHRequestTagReverseEvent))
+        } else {
+            respond()
+            readHeader()
+        }
+    }
+}
+
+private extension ReverseEventReader {
+    func readHeader() {
+        socket.readDataToData("\r\n\r\n".dataUsingEncoding(NSUTF8StringEncoding), withTimeout: -1, tag: Int(kAHRequestTagReverseEvent))
+    }
+    
+    func handleBody(data: NSData) {
+        //  answer first, the receiver waits for it before sending anything else
+        respond()
+        
+        guard reading else {
+            return
+        }
+        
+        var format: NSPropertyListFormat = .XMLFormat_v1_0
+        let eventAny: AnyObject
+        
+        do {
+            eventAny = try NSPropertyListSerialization.propertyListWithData(data, options: [], format: &format)
+        } catch {
+            print("Error parsing /reverse event: \(error)")
+            return
+        }
+        
+        guard let eventDictionary = eventAny as? [String:AnyObject] else {
+            print("Error parsing /reverse event into a dictionary")
+            return
+        }
+        
+        print("/reverse event: \(eventDictionary)")
+        
+        //  photo and slideshow events are no use to us
+        if let category = eventDictionary["category"] as? String where category != "video" {
+            return
+        }
+        
+        let event = ReverseEvent(state: eventDictionary["state"] as? String,
+                                 rate: ReverseEventReader.doubleValue(eventDictionary["rate"]),
+                                 position: ReverseEventReader.doubleValue(eventDictionary["position"]))
+        
+        delegate?.eventReader(self, didReceiveEvent: event)
+    }
+    
+    func respond() {
+        let response = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n"
+        socket.writeData(response.dataUsingEncoding(NSUTF8StringEncoding), withTimeout: 1, tag: Int(kAHRequestTagReverseEvent))
+    }
+    
+    static func contentLengthOfHeader(header: String) -> Int {
+        for line in header.componentsSeparatedByString("\r\n") {
+            let parts = line.componentsSeparatedByString(":")
+            
+            guard parts.count == 2 && parts[0].lowercaseString == "content-length" else {
+                continue
+            }
+            
+            return Int(parts[1].stringByTrimmingCharactersInSet(.whitespaceCharacterSet())) ?? 0
+        }
+        
+        return 0
+    }
+    
+    /// Receivers send numbers as either numbers or strings.
+    static func doubleValue(value: AnyObject?) -> Double? {
+        if let number = value as? NSNumber {
+            return number.doubleValue
+        } else if let string = value as? String {
+            return Double(string)
+        } else {
+            return nil
+        }
+    }
+}
+
+protocol ReverseEventReaderDelegate: class {
+    func eventReader(reader: ReverseEventReader, didReceiveEvent event: ReverseEvent)
+}
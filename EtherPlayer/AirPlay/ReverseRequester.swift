@@ -19,12 +19,17 @@ class ReverseRequester:  AirplayRequester {
         self.targetAddress = targetAddress
     }
     
-    func performRequest(baseURL: NSURL, sessionID: String, urlSession: NSURLSession) {
+    func performRequest(baseURL: NSURL, sessionID: String, connection: AirplayControlConnection) {
         NSLog("/reverse")
         
-        // Manually put together an HTTP request. We can't just make a request
-        // using `urlSession` because we don't want the `keep-alive` header that
-        // the OS would automatically add.
+        guard socket.isDisconnected() else {
+            print("/reverse connection already made or being made, not making another one.")
+            return
+        }
+        
+        // Manually put together an HTTP request, on its own connection. We can't
+        // use the control connection because this one is upgraded and then kept
+        // by the receiver for its own requests.
         let bodyString: CFString = ""
         let requestMethod: CFString = "POST"
         let myURL = baseURL.URLByAppendingPathComponent("reverse") as CFURLRef
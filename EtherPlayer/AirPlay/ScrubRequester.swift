@@ -13,19 +13,29 @@ class ScrubRequester: AirplayRequester {
     
     weak var delegate: ScrubRequesterDelegate?
     var requestCustomizer: AirplayRequestCustomizer?
-    var requestTask: NSURLSessionTask?
+    var requestTask: AirplayControlTask?
     
-    func performRequest(baseURL: NSURL, sessionID: String, urlSession: NSURLSession) {
+    /// The seek the receiver hasn't answered yet. Only one is sent at a time.
+    private var seekTask: AirplayControlTask?
+    /// The latest seek made while `seekTask` was in flight, to send once it's answered.
+    private var pendingSeekPosition: Double?
+    
+    func performRequest(baseURL: NSURL, sessionID: String, connection: AirplayControlConnection) {
         guard requestTask == nil else {
             print("\(relativeURL) request already in flight, not performing another one.")
             return
         }
         
+        guard seekTask == nil else {
+            print("Seek in flight, not asking for a position that's about to change.")
+            return
+        }
+        
         let url = NSURL(string: relativeURL, relativeToURL: baseURL)!
         let request = NSMutableURLRequest(URL: url)
         requestCustomizer?.requester(self, willPerformRequest: request)
         
-        let task = urlSession.dataTaskWithRequest(request, completionHandler: { [weak self] (data, response, error) in
+        let task = connection.dataTaskWithRequest(request, completionHandler: { [weak self] (data, response, error) in
             //  update our position in the file after /scrub
             guard let strongSelf = self else {
                 return
@@ -59,8 +69,62 @@ class ScrubRequester: AirplayRequester {
         requestTask?.cancel()
         requestTask = nil
     }
+    
+    /**
+     Seek to `position` in the input with a POST to /scrub.
+     
+     Seeks made while the receiver is still answering an earlier one are collapsed into the latest,
+     which is sent as soon as the earlier one is answered, so seeks go out as fast as the receiver
+     can take them and never queue up behind each other.
+     */
+    func seekToPosition(position: Double, baseURL: NSURL, connection: AirplayControlConnection) {
+        //  a position request in flight would be answered with where we were
+        cancelRequest()
+        
+        guard seekTask == nil else {
+            pendingSeekPosition = position
+            return
+        }
+        
+        sendSeek(position, baseURL: baseURL, connection: connection)
+    }
+}
+
+private extension ScrubRequester {
+    func sendSeek(position: Double, baseURL: NSURL, connection: AirplayControlConnection) {
+        let scrubPosition = delegate?.requester(self, playbackPositionForSeekToPosition: position) ?? position
+        
+        let url = NSURL(string: String(format: "%@?position=%.6f", relativeURL, scrubPosition), relativeToURL: baseURL)!
+        let request = NSMutableURLRequest(URL: url)
+        request.HTTPMethod = "POST"
+        requestCustomizer?.requester(self, willPerformRequest: request)
+        
+        let task = connection.dataTaskWithRequest(request) { [weak self] (data, response, error) in
+            guard let strongSelf = self else {
+                return
+            }
+            
+            strongSelf.seekTask = nil
+            
+            if let error = error {
+                print("Error seeking with /scrub: \(error)")
+            }
+            
+            //  the receiver is ready for another seek, so send the latest one that came in meanwhile
+            if let pendingSeekPosition = strongSelf.pendingSeekPosition {
+                strongSelf.pendingSeekPosition = nil
+                strongSelf.sendSeek(pendingSeekPosition, baseURL: baseURL, connection: connection)
+            }
+        }
+        
+        seekTask = task
+        task.resume()
+    }
 }
 
 protocol ScrubRequesterDelegate: class {
     func playbackPositionUpdated(playbackPosition: Double)
+    
+    /// Get ready to seek to `position` in the input, and return the receiver's position to seek to.
+    func requester(requester: ScrubRequester, playbackPositionForSeekToPosition position: Double) -> Double
 }
@@ -14,15 +14,15 @@ class ServerInfoRequester: AirplayRequester {
     weak var delegate: ServerInfoRequesterDelegate?
     var requestCustomizer: AirplayRequestCustomizer?
     
-    private var requestTask: NSURLSessionTask?
+    private var requestTask: AirplayControlTask?
     
-    func performRequest(baseURL: NSURL, sessionID: String, urlSession: NSURLSession) {
+    func performRequest(baseURL: NSURL, sessionID: String, connection: AirplayControlConnection) {
         //  make a request to /server-info on the target to get some info before
         let url = NSURL(string: relativeURL, relativeToURL: baseURL)!
         let request = NSMutableURLRequest(URL: url)
         requestCustomizer?.requester(self, willPerformRequest: request)
         
-        let task = urlSession.dataTaskWithRequest(request) { [weak self] (data, response, error) in
+        let task = connection.dataTaskWithRequest(request) { [weak self] (data, response, error) in
             guard let strongSelf = self else {
                 return
             }
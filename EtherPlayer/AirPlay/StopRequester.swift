@@ -14,9 +14,9 @@ class StopRequester: AirplayRequester {
     weak var delegate: StopRequesterDelegate?
     weak var requestCustomizer: AirplayRequestCustomizer?
     
-    private var requestTask: NSURLSessionTask?
+    private var requestTask: AirplayControlTask?
     
-    func performRequest(baseURL: NSURL, sessionID: String, urlSession: NSURLSession) {
+    func performRequest(baseURL: NSURL, sessionID: String, connection: AirplayControlConnection) {
         guard requestTask == nil else {
             print("\(relativeURL) request already in flight, not performing another one.")
             return
@@ -27,7 +27,7 @@ class StopRequester: AirplayRequester {
         
         requestCustomizer?.requester(self, willPerformRequest: request)
         
-        let task = urlSession.dataTaskWithRequest(request) { [weak self] (data, response, error) in
+        let task = connection.dataTaskWithRequest(request) { [weak self] (data, response, error) in
             defer {
                 self?.requestTask = nil
             }
@@ -19,17 +19,33 @@ class AppDelegate: NSObject, NSApplicationDelegate {
     @IBAction func openFile(sender: AnyObject?) {
         let panel = NSOpenPanel()
         panel.canChooseFiles = true
-        panel.allowsMultipleSelection = false
+        panel.allowsMultipleSelection = true
         
         panel.beginWithCompletionHandler { (result) in
             guard result == NSFileHandlingPanelOKButton else {
                 return
             }
             
-            self.application(NSApplication.sharedApplication(), openFile: panel.URL!.absoluteString)
+            self.application(NSApplication.sharedApplication(), openFiles: panel.URLs.map { $0.path! })
         }
     }
     
+    //  the first file plays now, and the rest are queued up after it
+    func application(sender: NSApplication, openFiles filenames: [String]) {
+        guard let firstFilename = filenames.first else {
+            return
+        }
+        
+        self.application(sender, openFile: firstFilename)
+        
+        for filename in filenames.dropFirst() {
+            NSDocumentController.sharedDocumentController().noteNewRecentDocumentURL(NSURL(fileURLWithPath: filename))
+            viewController.videoConverter.enqueueMedia(filename)
+        }
+        
+        sender.replyToOpenOrPrint(.Success)
+    }
+    
     func application(sender: NSApplication, openFile filename: String) -> Bool {
         let controller = NSDocumentController.sharedDocumentController()
         controller.noteNewRecentDocumentURL(NSURL(fileURLWithPath: filename))
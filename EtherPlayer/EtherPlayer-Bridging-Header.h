@@ -9,5 +9,6 @@
 
 #import "HTTPServer.h"
 
+#import <CommonCrypto/CommonCrypto.h>
 #import <arpa/inet.h>
 #import <ifaddrs.h>
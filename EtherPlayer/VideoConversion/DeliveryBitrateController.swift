@@ -0,0 +1,100 @@
+//
+//  DeliveryBitrateController.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/**
+ Chooses the video bitrate of upcoming conversion work from how fast the receiver is actually
+ downloading what the HTTP server sends it.
+ 
+ Every long enough response the server finishes is a goodput sample. Samples are smoothed,
+ reacting quickly when goodput drops and slowly when it recovers, so a congested network soon
+ gets smaller segments, but a single fast response doesn't undo that.
+ 
+ All methods are thread-safe.
+ */
+class DeliveryBitrateController: NSObject {
+    /// The fraction of the measured goodput the stream may use, leaving room for throughput to dip.
+    let safetyMargin: Double
+    /// In kilobits per second.
+    let minimumVideoBitrate: Int
+    
+    private let queue = dispatch_queue_create("DeliveryBitrateController", DISPATCH_QUEUE_SERIAL)
+    
+    /// In bytes per second.
+    private var smoothedGoodput: Double?
+    
+    init(safetyMargin: Double, minimumVideoBitrate: Int) {
+        self.safetyMargin = safetyMargin
+        self.minimumVideoBitrate = minimumVideoBitrate
+        
+        super.init()
+        
+        //  posted on the connections' queues
+        NSNotificationCenter.defaultCenter().addObserver(self, selector: #selector(DeliveryBitrateController.connectionDidMeasureGoodput(_:)), name: HTTPConnectionDidMeasureGoodputNotification, object: nil)
+    }
+    
+    deinit {
+        NSNotificationCenter.defaultCenter().removeObserver(self)
+    }
+    
+    /// The smoothed goodput of recent responses in kilobits per second, or `nil` before any were measured.
+    var measuredGoodput: Int? {
+        var goodput: Double?
+        dispatch_sync(queue) {
+            goodput = self.smoothedGoodput
+        }
+        
+        return goodput.map { Int($0 * 8 / 1000) }
+    }
+    
+    /**
+     The video bitrate, in kilobits per second, that fits in the measured goodput alongside `audioBitrate`.
+     Never more than `ceiling`, the bitrate the input would be converted at on an unconstrained network,
+     and `ceiling` itself until goodput has been measured.
+     */
+    func videoBitrate(ceiling ceiling: Int, audioBitrate: Int) -> Int {
+        guard let goodput = measuredGoodput else {
+            return ceiling
+        }
+        
+        let available = Int(Double(goodput) * safetyMargin) - audioBitrate
+        return min(ceiling, max(minimumVideoBitrate, available))
+    }
+    
+    /**
+     The video bitrate to convert with now, if lower than the one in `transcodingOptions`,
+     which are options for VLCKit's transcode module, as given to `VLCStreamOutput`.
+     */
+    func reducedVideoBitrate(transcodingOptions: [String : AnyObject]) -> Int? {
+        guard let ceiling = (transcodingOptions["videoBitrate"] as? String).flatMap({ Int($0) }) else {
+            return nil
+        }
+        
+        let audioBitrate = (transcodingOptions["audioBitrate"] as? String).flatMap { Int($0) } ?? 0
+        let bitrate = videoBitrate(ceiling: ceiling, audioBitrate: audioBitrate)
+        
+        return bitrate < ceiling ? bitrate : nil
+    }
+    
+    @objc private func connectionDidMeasureGoodput(notification: NSNotification) {
+        guard let goodput = (notification.userInfo?[HTTPConnectionGoodputKey] as? NSNumber)?.doubleValue where goodput > 0 else {
+            return
+        }
+        
+        dispatch_async(queue) {
+            guard let current = self.smoothedGoodput else {
+                self.smoothedGoodput = goodput
+                return
+            }
+            
+            let gain = goodput < current ? kOVCGoodputDropGain : kOVCGoodputRecoveryGain
+            self.smoothedGoodput = current + gain * (goodput - current)
+        }
+    }
+}
@@ -0,0 +1,53 @@
+//
+//  FileSystemWatcher.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/**
+ Calls a handler on the main queue whenever a file or directory changes.
+ 
+ For a directory, that's whenever an entry in it is added, removed or renamed.
+ For a file, it's whenever the file is written to or extended.
+ Changes that happen in quick succession may be reported with a single call.
+ */
+class FileSystemWatcher {
+    let path: String
+    
+    private let source: dispatch_source_t
+    
+    /**
+     Start watching the file or directory at `path`.
+     Fails if there's nothing at `path` to watch yet.
+     */
+    init?(path: String, handler: () -> Void) {
+        self.path = path
+        
+        let fileDescriptor = open(path, O_EVTONLY)
+        guard fileDescriptor >= 0 else {
+            return nil
+        }
+        
+        let mask = DISPATCH_VNODE_WRITE | DISPATCH_VNODE_EXTEND
+        source = dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, UInt(fileDescriptor), mask, dispatch_get_main_queue())
+        
+        dispatch_source_set_event_handler(source, handler)
+        dispatch_source_set_cancel_handler(source) {
+            close(fileDescriptor)
+        }
+        dispatch_resume(source)
+    }
+    
+    deinit {
+        cancel()
+    }
+    
+    /// Stop watching. The handler won't be called again.
+    func cancel() {
+        dispatch_source_cancel(source)
+    }
+}
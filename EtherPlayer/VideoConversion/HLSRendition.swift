@@ -0,0 +1,161 @@
+//
+//  HLSRendition.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+import VLCKit
+
+/**
+ A lower-resolution, lower-bitrate variant of an HLS conversion, converted alongside the main one,
+ so receivers can switch to it when their throughput drops.
+ 
+ Each rendition's encoder is given the main conversion's key frame interval, with scene cut detection off,
+ and is segmented on the same schedule as it, so every segment boundary falls on the same frame in each.
+ Renditions are only made when the main conversion's video is converted, since otherwise it keeps the input's key frames.
+ VLCKit's stream output can't feed one decode into several encoders, so each rendition's session
+ decodes the input itself.
+ */
+class HLSRendition {
+    /// A playlist listed in a master playlist.
+    struct Variant {
+        let playlistURL: String
+        /// Peak bits per second.
+        let bandwidth: Int
+        let resolution: (width: Int, height: Int)?
+    }
+    
+    let width: Int
+    /// In kilobits per second.
+    let videoBitrate: Int
+    
+    let playlistPath: String
+    let playlistURL: String
+    
+    private let session: VLCStreamSession
+    private let scheduler: HLSSegmentScheduler
+    
+    var isComplete: Bool {
+        return session.isComplete
+    }
+    
+    /// How far into the input the rendition has been converted, in seconds.
+    var convertedPosition: NSTimeInterval {
+        return session.convertedPosition
+    }
+    
+    /// Files an unfinished earlier conversion of this rendition may have left behind, which would look ready.
+    var stalePaths: [String] {
+        return [playlistPath, scheduler.segmenterPlaylistPath]
+    }
+    
+    static func playlistFilename(sessionFilename: String, index: Int) -> String {
+        return "\(sessionFilename)-rendition\(index).m3u8"
+    }
+    
+    /**
+     Set up the rendition numbered `index` of the input at `inputPath`, `width` pixels wide.
+     `transcodingOptions` are the main conversion's, which are scaled down for this rendition,
+     and must set the "videoEncoder" the main conversion's key frames are forced with.
+     Segments are handed to `segmentStore` as they're finished, if there is one.
+     */
+    init(inputPath: String, index: Int, width: Int, transcodingOptions: [String : AnyObject], baseFilePath: String, baseHTTPAddress: String, sessionFilename: String, segmentStore: SegmentStore?) {
+        self.width = width
+        
+        //  the same rule of thumb as the main conversion
+        videoBitrate = width * 3
+        
+        let playlistFilename = HLSRendition.playlistFilename(sessionFilename, index: index)
+        playlistPath = baseFilePath.stringByAppendingString(playlistFilename)
+        playlistURL = baseHTTPAddress.stringByAppendingString(playlistFilename)
+        
+        let renditionFilename = (playlistFilename as NSString).stringByDeletingPathExtension
+        let segmenterPlaylistPath = baseFilePath.stringByAppendingString("\(renditionFilename)-segmenter.m3u8")
+        let scheduledFilenamePrefix = "\(renditionFilename)-scheduled-"
+        
+        scheduler = HLSSegmentScheduler(
+            startupDurations: kOVCStartupSegmentDurations.map { NSTimeInterval($0) },
+            steadyDuration: NSTimeInterval(kOVCSegmentDuration),
+            segmenterDuration: NSTimeInterval(kOVCSegmenterSegmentDuration),
+            keyFramesForced: true,
+            segmenterPlaylistPath: segmenterPlaylistPath,
+            playlistPath: playlistPath,
+            segmentPathPrefix: baseFilePath.stringByAppendingString(scheduledFilenamePrefix),
+            segmentURLPrefix: baseHTTPAddress.stringByAppendingString(scheduledFilenamePrefix),
+            deletesJoinedSegments: kOVCDeleteJoinedSegments,
+            segmentStore: segmentStore)
+        
+        assert(transcodingOptions["videoEncoder"] != nil, "Renditions need the main conversion's key frame interval")
+        
+        //  audio is converted (or not) just as it is for the main conversion, and key frames
+        //  are forced at the same interval, through the same "videoEncoder"
+        var renditionTranscodingOptions = transcodingOptions
+        renditionTranscodingOptions["videoCodec"] = "h264"
+        renditionTranscodingOptions["videoBitrate"] = "\(videoBitrate)"
+        renditionTranscodingOptions["width"] = "\(width)"
+        
+        let segmentTemplate = "\(renditionFilename)-#####.\(kOVCHLSOutputFiletype)"
+        let segmentURLTemplate = baseHTTPAddress.stringByAppendingString(segmentTemplate)
+        
+        let access = "livehttp{seglen=\(kOVCSegmenterSegmentDuration),delsegs=false,index=\(segmenterPlaylistPath),index-url=\(segmentURLTemplate)}"
+        let outputOptions = [
+            "access" : access,
+            "muxer" : "\(kOVCHLSOutputFiletype){use-key-frames}",
+            "destination" : baseFilePath.stringByAppendingString(segmentTemplate),
+        ]
+        
+        session = VLCStreamSession()
+        session.media = VLCMedia(path: inputPath)
+        session.streamOutput = VLCStreamOutput(optionDictionary: [
+            "transcodingOptions" : renditionTranscodingOptions,
+            "outputOptions" : outputOptions,
+            ])
+    }
+    
+    func start() {
+        session.startStreaming()
+    }
+    
+    func stop() {
+        session.stopStreaming()
+    }
+    
+    func setPaused(paused: Bool) {
+        session.setConversionPaused(paused)
+    }
+    
+    /// Pick up any segments the session has finished since the last update.
+    func update() {
+        scheduler.update()
+    }
+    
+    /// Write a master playlist listing `variants`, the first of which receivers start with.
+    static func writeMasterPlaylist(path: String, variants: [Variant]) {
+        var lines = [
+            "#EXTM3U",
+            "#EXT-X-VERSION:3",
+        ]
+        
+        for variant in variants {
+            var attributes = "BANDWIDTH=\(variant.bandwidth)"
+            if let resolution = variant.resolution {
+                attributes += ",RESOLUTION=\(resolution.width)x\(resolution.height)"
+            }
+            
+            lines.append("#EXT-X-STREAM-INF:\(attributes)")
+            lines.append(variant.playlistURL)
+        }
+        
+        let playlist = lines.joinWithSeparator("\n") + "\n"
+        
+        do {
+            try playlist.writeToFile(path, atomically: true, encoding: NSUTF8StringEncoding)
+        } catch {
+            print("Couldn't write HLS master playlist: \(path), \(error)")
+        }
+    }
+}
@@ -0,0 +1,326 @@
+//
+//  HLSSegmentScheduler.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/**
+ Regroups the segments written by VLCKit's livehttp output to follow a schedule of durations,
+ with short segments first so playback can start sooner, and longer segments after that.
+ 
+ livehttp cuts every segment to the same length, so it's run at the shortest scheduled duration,
+ and consecutive segments are joined until they reach the next scheduled duration.
+ livehttp only cuts on key frames, and MPEG-TS segments can be joined by concatenating them,
+ so joined segments stay key frame aligned.
+ 
+ The joined segments and their playlist are written next to livehttp's own,
+ and the playlist is only written once its first segment is complete. With `deletesJoinedSegments`,
+ livehttp's segments are deleted once they've been joined, as they're only ever served joined.
+ With a `segmentStore`, each joined segment is also stored as it's joined, rather than read back from disk.
+ Segments are never joined across a discontinuity, such as between the chunks of a parallel conversion.
+ 
+ Joined segments that playback has left behind can be discarded, to save disk space. They stay listed,
+ and are joined again by `restoreDiscardedSegments(from:through:)` once livehttp's segments are back on disk.
+ */
+class HLSSegmentScheduler {
+    /// Durations of the first segments, in order.
+    let startupDurations: [NSTimeInterval]
+    /// Duration of every segment after the startup segments.
+    let steadyDuration: NSTimeInterval
+    /// Duration of the segments livehttp cuts, which should be the shortest scheduled duration.
+    let segmenterDuration: NSTimeInterval
+    
+    /// The playlist livehttp writes.
+    let segmenterPlaylistPath: String
+    /// The playlist of joined segments, which is what gets served.
+    let playlistPath: String
+    
+    /// Joined segments are written to this path prefix, followed by their index.
+    let segmentPathPrefix: String
+    /// Joined segments are listed in the playlist under this URL prefix, followed by their index.
+    let segmentURLPrefix: String
+    
+    let deletesJoinedSegments: Bool
+    
+    /// Store that joined segments are handed to, so they're served from memory.
+    let segmentStore: SegmentStore?
+    
+    /**
+     The playlist's target duration, which every segment's duration must round to at most.
+     
+     An EVENT playlist's target duration can't change, so it's fixed up front. With `keyFramesForced`,
+     livehttp cuts on schedule, and it's the longest scheduled duration. Otherwise livehttp can only cut
+     on the input's key frames, so it's at least `kOVCUnforcedTargetDuration`, and a segment is joined early
+     rather than run past it. Only a single livehttp segment that's already longer than that can still exceed it.
+     */
+    let targetDuration: Int
+    
+    /// `discontinuity` is `true` if the segment doesn't continue on from the one before it.
+    private typealias Segment = (path: String, duration: NSTimeInterval, discontinuity: Bool)
+    
+    /// Number of livehttp segments that have been joined, or are waiting to be.
+    private var consumedSegmenterSegmentCount = 0
+    private var pendingSegments: [Segment] = []
+    private var segments: [Segment] = []
+    /// The paths of the livehttp segments each joined segment was joined from.
+    private var joinedSourcePaths: [[String]] = []
+    /// Joined segments that have been deleted, though they're still listed.
+    private var discardedSegmentIndices: Set<Int> = []
+    /// Number of joined segments listed in the playlist written so far.
+    private var listedSegmentCount = 0
+    private var finished = false
+    
+    init(startupDurations: [NSTimeInterval], steadyDuration: NSTimeInterval, segmenterDuration: NSTimeInterval, keyFramesForced: Bool, segmenterPlaylistPath: String, playlistPath: String, segmentPathPrefix: String, segmentURLPrefix: String, deletesJoinedSegments: Bool, segmentStore: SegmentStore?) {
+        self.startupDurations = startupDurations
+        self.steadyDuration = steadyDuration
+        self.segmenterDuration = segmenterDuration
+        
+        let longestScheduledDuration = (startupDurations + [steadyDuration]).maxElement() ?? steadyDuration
+        let scheduledTargetDuration = max(1, Int(ceil(longestScheduledDuration)))
+        targetDuration = keyFramesForced ? scheduledTargetDuration : max(scheduledTargetDuration, Int(kOVCUnforcedTargetDuration))
+        
+        self.segmenterPlaylistPath = segmenterPlaylistPath
+        self.playlistPath = playlistPath
+        self.segmentPathPrefix = segmentPathPrefix
+        self.segmentURLPrefix = segmentURLPrefix
+        self.deletesJoinedSegments = deletesJoinedSegments
+        self.segmentStore = segmentStore
+    }
+    
+    /**
+     Join any segments livehttp has finished since the last update, as far as the schedule allows,
+     and rewrite the playlist if that produced new segments.
+     
+     Returns `true` if the playlist was rewritten.
+     */
+    func update() -> Bool {
+        guard !finished, let segmenterPlaylist = try? String(contentsOfFile: segmenterPlaylistPath, encoding: NSUTF8StringEncoding) else {
+            return false
+        }
+        
+        let (segmenterSegments, ended) = parsePlaylist(segmenterPlaylist)
+        
+        var joinFailed = false
+        
+        for segment in segmenterSegments.suffixFrom(consumedSegmenterSegmentCount) {
+            //  close off the segment before a discontinuity early, however short it is
+            if segment.discontinuity && !pendingSegments.isEmpty && !joinPendingSegments() {
+                joinFailed = true
+                break
+            }
+            
+            //  and the pending segments, if this one would take them past the target duration
+            let pendingDuration = pendingSegments.reduce(0) { $0 + $1.duration }
+            if !pendingSegments.isEmpty && Int(round(pendingDuration + segment.duration)) > targetDuration && !joinPendingSegments() {
+                joinFailed = true
+                break
+            }
+            
+            pendingSegments.append(segment)
+            consumedSegmenterSegmentCount += 1
+            
+            let joinedDuration = pendingSegments.reduce(0) { $0 + $1.duration }
+            if joinedDuration >= scheduledDuration(segments.count) && !joinPendingSegments() {
+                joinFailed = true
+                break
+            }
+        }
+        
+        //  whatever is left over makes up the final, short segment
+        if ended && !joinFailed && !pendingSegments.isEmpty {
+            joinFailed = !joinPendingSegments()
+        }
+        
+        let nowFinished = ended && !joinFailed && pendingSegments.isEmpty
+        
+        guard segments.count > listedSegmentCount || nowFinished else {
+            return false
+        }
+        
+        finished = nowFinished
+        listedSegmentCount = segments.count
+        writePlaylist()
+        
+        return true
+    }
+    
+    /**
+     Delete the listed segments that end before `playlistTime`, along with their copies in the segment store.
+     Nothing is deleted with `deletesJoinedSegments`, as the segments couldn't be joined again.
+     */
+    func discardSegments(endingBefore playlistTime: NSTimeInterval) {
+        guard !deletesJoinedSegments else {
+            return
+        }
+        
+        var segmentEnd: NSTimeInterval = 0
+        
+        for (index, segment) in segments.prefix(listedSegmentCount).enumerate() {
+            segmentEnd += segment.duration
+            
+            guard segmentEnd <= playlistTime else {
+                break
+            }
+            
+            if discardedSegmentIndices.contains(index) {
+                continue
+            }
+            
+            _ = try? NSFileManager.defaultManager().removeItemAtPath(segment.path)
+            segmentStore?.removeSegmentForFilePath(segment.path)
+            discardedSegmentIndices.insert(index)
+        }
+    }
+    
+    /// Join the discarded segments between `startTime` and `endTime` again, once their livehttp segments are all back on disk.
+    func restoreDiscardedSegments(from startTime: NSTimeInterval, through endTime: NSTimeInterval) {
+        let fileManager = NSFileManager.defaultManager()
+        
+        for index in discardedSegmentIndices.sort() {
+            let segmentStart = segments.prefix(index).reduce(0) { $0 + $1.duration }
+            let sourcePaths = joinedSourcePaths[index]
+            
+            guard segmentStart < endTime && segmentStart + segments[index].duration > startTime,
+                sourcePaths.reduce(true, combine: { $0 && fileManager.fileExistsAtPath($1) }) else {
+                continue
+            }
+            
+            if joinSegmentFiles(sourcePaths, toPath: segments[index].path) {
+                discardedSegmentIndices.remove(index)
+            }
+        }
+    }
+}
+
+private extension HLSSegmentScheduler {
+    func scheduledDuration(index: Int) -> NSTimeInterval {
+        //  allow for livehttp's durations being rounded a little short
+        let tolerance = 0.05
+        
+        let duration = index < startupDurations.count ? startupDurations[index] : steadyDuration
+        return duration - tolerance
+    }
+    
+    /// Returns the segments listed in an HLS playlist, and whether the playlist is complete.
+    func parsePlaylist(playlist: String) -> (segments: [Segment], ended: Bool) {
+        let directory = (segmenterPlaylistPath as NSString).stringByDeletingLastPathComponent
+        
+        var segments: [Segment] = []
+        var ended = false
+        var duration: NSTimeInterval?
+        var discontinuity = false
+        
+        for line in playlist.componentsSeparatedByCharactersInSet(NSCharacterSet.newlineCharacterSet()) {
+            if line.hasPrefix("#EXTINF:") {
+                let value = line.substringFromIndex(line.startIndex.advancedBy("#EXTINF:".characters.count))
+                duration = value.componentsSeparatedByString(",").first.flatMap { Double($0) }
+            } else if line.hasPrefix("#EXT-X-DISCONTINUITY") {
+                discontinuity = true
+            } else if line.hasPrefix("#EXT-X-ENDLIST") {
+                ended = true
+            } else if !line.isEmpty && !line.hasPrefix("#") {
+                //  segments are listed by URL, but they're in the same directory as the playlist
+                let filename = (line as NSString).lastPathComponent
+                let path = (directory as NSString).stringByAppendingPathComponent(filename)
+                segments.append((path: path, duration: duration ?? segmenterDuration, discontinuity: discontinuity))
+                duration = nil
+                discontinuity = false
+            }
+        }
+        
+        return (segments, ended)
+    }
+    
+    /// Join the pending segments into the next scheduled segment. Returns `false` if that failed.
+    func joinPendingSegments() -> Bool {
+        let path = segmentPath(segments.count)
+        let sourcePaths = pendingSegments.map { $0.path }
+        
+        guard joinSegmentFiles(sourcePaths, toPath: path) else {
+            return false
+        }
+        
+        let duration = pendingSegments.reduce(0) { $0 + $1.duration }
+        let discontinuity = pendingSegments.first?.discontinuity ?? false
+        segments.append((path: path, duration: duration, discontinuity: discontinuity))
+        joinedSourcePaths.append(sourcePaths)
+        
+        //  livehttp's playlist still lists them, but they're never read again once joined
+        if deletesJoinedSegments {
+            for segment in pendingSegments {
+                _ = try? NSFileManager.defaultManager().removeItemAtPath(segment.path)
+            }
+        }
+        
+        pendingSegments.removeAll()
+        
+        return true
+    }
+    
+    /// Join the segments at `sourcePaths` into one at `path`. Returns `false` if that failed.
+    func joinSegmentFiles(sourcePaths: [String], toPath path: String) -> Bool {
+        let joinedData = NSMutableData()
+        
+        for sourcePath in sourcePaths {
+            guard let data = NSData(contentsOfFile: sourcePath) else {
+                print("Couldn't read segment to join: \(sourcePath)")
+                return false
+            }
+            
+            joinedData.appendData(data)
+        }
+        
+        guard joinedData.writeToFile(path, atomically: true) else {
+            print("Couldn't write joined segment: \(path)")
+            return false
+        }
+        
+        //  stored before it's listed, so it's in memory by the time the receiver asks for it
+        segmentStore?.storeSegment(joinedData, forFilePath: path)
+        
+        return true
+    }
+    
+    func segmentPath(index: Int) -> String {
+        return segmentPathPrefix + String(format: "%05d.\(kOVCHLSOutputFiletype)", index)
+    }
+    
+    func segmentURL(index: Int) -> String {
+        return segmentURLPrefix + String(format: "%05d.\(kOVCHLSOutputFiletype)", index)
+    }
+    
+    func writePlaylist() {
+        var lines = [
+            "#EXTM3U",
+            "#EXT-X-VERSION:3",
+            "#EXT-X-TARGETDURATION:\(targetDuration)",
+            "#EXT-X-MEDIA-SEQUENCE:0",
+            "#EXT-X-PLAYLIST-TYPE:EVENT",
+        ]
+        
+        for (index, segment) in segments.enumerate() {
+            if segment.discontinuity {
+                lines.append("#EXT-X-DISCONTINUITY")
+            }
+            lines.append(String(format: "#EXTINF:%.3f,", segment.duration))
+            lines.append(segmentURL(index))
+        }
+        
+        if finished {
+            lines.append("#EXT-X-ENDLIST")
+        }
+        
+        let playlist = lines.joinWithSeparator("\n") + "\n"
+        
+        //  write atomically, so the playlist never appears half written
+        do {
+            try playlist.writeToFile(playlistPath, atomically: true, encoding: NSUTF8StringEncoding)
+        } catch {
+            print("Couldn't write HLS playlist: \(playlistPath), \(error)")
+        }
+    }
+}
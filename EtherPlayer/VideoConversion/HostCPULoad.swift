@@ -0,0 +1,55 @@
+//
+//  HostCPULoad.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/**
+ Measures how busy the machine's processors are, across every process, from one sample to the next.
+ */
+class HostCPULoad {
+    private var previousTicks: (busy: UInt64, total: UInt64)?
+    
+    /// The fraction of processor time spent busy since the previous sample, or `nil` for the first sample.
+    func sample() -> Double? {
+        guard let ticks = HostCPULoad.cpuTicks() else {
+            return nil
+        }
+        
+        defer {
+            previousTicks = ticks
+        }
+        
+        guard let previous = previousTicks where ticks.total > previous.total else {
+            return nil
+        }
+        
+        return Double(ticks.busy - previous.busy) / Double(ticks.total - previous.total)
+    }
+}
+
+private extension HostCPULoad {
+    /// Processor ticks since boot, summed over every processor.
+    static func cpuTicks() -> (busy: UInt64, total: UInt64)? {
+        var info = host_cpu_load_info()
+        var count = mach_msg_type_number_t(sizeof(host_cpu_load_info) / sizeof(integer_t))
+        
+        let result = withUnsafeMutablePointer(&info) {
+            host_statistics(mach_host_self(), HOST_CPU_LOAD_INFO, UnsafeMutablePointer($0), &count)
+        }
+        
+        guard result == KERN_SUCCESS else {
+            return nil
+        }
+        
+        //  user, system, idle and nice, in that order
+        let ticks = info.cpu_ticks
+        let busy = UInt64(ticks.0) + UInt64(ticks.1) + UInt64(ticks.3)
+        
+        return (busy, busy + UInt64(ticks.2))
+    }
+}
@@ -0,0 +1,156 @@
+//
+//  MediaProbe.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+import VLCKit
+
+/**
+ What VLCKit found out about a media file's tracks, along with the decisions made from it.
+ 
+ Probes are kept in a `MediaProbeIndex`, so files don't need to be parsed again.
+ */
+struct MediaProbe {
+    /// Containers that AirPlay devices play as they are.
+    static let directPlayContainers: Set<String> = ["mp4", "m4v", "mov"]
+    
+    //  h264 is 875967080
+    static let directPlayVideoCodecs: Set<String> = ["875967080"]
+    
+    //  AAC is 1630826605
+    //  MP3 is 1634168941
+    static let directPlayAudioCodecs: Set<String> = ["1630826605", "1634168941"]
+    
+    let path: String
+    
+    /// The track properties as returned by `VLCMedia.tracksInformation`.
+    let tracksInformation: [[String : AnyObject]]
+    
+    /// In seconds.
+    let duration: Double
+    
+    /**
+     `true` if the file can be served as it is, without remuxing or transcoding.
+     That's H.264 video no wider than 1920, and AAC or MP3 audio of up to 6 channels,
+     in an MP4 or QuickTime container.
+     */
+    let isDirectPlayable: Bool
+    
+    private static let tracksInformationKey = "TracksInformation"
+    private static let durationKey = "Duration"
+    private static let directPlayableKey = "DirectPlayable"
+    
+    /// Probe `media`, which is parsed if it hasn't been already.
+    init(media: VLCMedia, path: String) {
+        self.path = path
+        
+        tracksInformation = media.tracksInformation as? [[String : AnyObject]] ?? []
+        duration = Double(media.length.intValue) / 1000
+        
+        let containerExtension = (path as NSString).pathExtension.lowercaseString
+        isDirectPlayable = MediaProbe.directPlayContainers.contains(containerExtension) && MediaProbe.tracksAreDirectPlayable(tracksInformation)
+    }
+    
+    /// Restore a probe from its property list representation.
+    init?(path: String, propertyList: [String : AnyObject]) {
+        guard let tracksInformation = propertyList[MediaProbe.tracksInformationKey] as? [[String : AnyObject]],
+            let duration = propertyList[MediaProbe.durationKey] as? Double,
+            let isDirectPlayable = propertyList[MediaProbe.directPlayableKey] as? Bool else {
+            return nil
+        }
+        
+        self.path = path
+        self.tracksInformation = tracksInformation
+        self.duration = duration
+        self.isDirectPlayable = isDirectPlayable
+    }
+    
+    /// The size of the first video track, if there is one.
+    var videoDimensions: (width: Int, height: Int)? {
+        for properties in tracksInformation where properties["type"] as? String == "video" {
+            guard let width = (properties["width"] as? String).flatMap({ Int($0) }),
+                let height = (properties["height"] as? String).flatMap({ Int($0) }) where width > 0 && height > 0 else {
+                return nil
+            }
+            
+            return (width, height)
+        }
+        
+        return nil
+    }
+    
+    /// The frame rate of the first video track, in frames per second, if there is one and it's known.
+    var videoFrameRate: Double? {
+        for properties in tracksInformation where properties["type"] as? String == "video" {
+            let frameRate = MediaProbe.doubleValue(properties[VLCMediaTracksInformationFrameRate])
+            let denominator = MediaProbe.doubleValue(properties[VLCMediaTracksInformationFrameRateDenominator]) ?? 1
+            
+            guard let numerator = frameRate where numerator > 0 && denominator > 0 else {
+                return nil
+            }
+            
+            return numerator / denominator
+        }
+        
+        return nil
+    }
+    
+    /// The probe, including the decisions made from it, as a property list.
+    var propertyList: [String : AnyObject] {
+        return [
+            MediaProbe.tracksInformationKey : tracksInformation,
+            MediaProbe.durationKey : duration,
+            MediaProbe.directPlayableKey : isDirectPlayable,
+        ]
+    }
+}
+
+private extension MediaProbe {
+    /// Track properties are numbers, or numbers as strings.
+    static func doubleValue(value: AnyObject?) -> Double? {
+        if let number = value as? NSNumber {
+            return number.doubleValue
+        } else if let string = value as? String {
+            return Double(string)
+        } else {
+            return nil
+        }
+    }
+    
+    static func tracksAreDirectPlayable(tracksInformation: [[String : AnyObject]]) -> Bool {
+        var hasVideo = false
+        
+        for properties in tracksInformation {
+            guard let type = properties["type"] as? String else {
+                continue
+            }
+            
+            switch type {
+            case "video":
+                hasVideo = true
+                
+                let codec = properties["codec"] as? String ?? ""
+                let width = (properties["width"] as? String).flatMap { Int($0) } ?? 0
+                guard directPlayVideoCodecs.contains(codec) && width <= 1920 else {
+                    return false
+                }
+            case "audio":
+                let codec = properties["codec"] as? String ?? ""
+                let channels = (properties["channelsNumber"] as? String).flatMap { Int($0) } ?? 0
+                guard directPlayAudioCodecs.contains(codec) && channels <= 6 else {
+                    return false
+                }
+            default:
+                //  subtitles and other tracks are simply ignored by the receiver
+                continue
+            }
+        }
+        
+        return hasVideo
+    }
+}
@@ -0,0 +1,124 @@
+//
+//  MediaProbeIndex.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+import VLCKit
+
+/**
+ A persistent index of media probes, so files don't need to be parsed by VLCKit every time they're played.
+ 
+ Probes are keyed by path, and are only used while the file's size and modification date
+ match those it was probed with. The index is saved to `indexPath` whenever a probe is added.
+ 
+ Should only be used from the main queue.
+ */
+class MediaProbeIndex {
+    let indexPath: String
+    
+    /// Number of probes found in the index.
+    private(set) var hitCount = 0
+    /// Number of probes that had to be made, because the index had none, or an outdated one.
+    private(set) var missCount = 0
+    
+    /// Bump when `MediaProbe` changes in a way that makes earlier probes wrong.
+    private static let version = 2
+    
+    /// Modification dates are kept as seconds since 1970, and match if they're this close.
+    private static let modificationDateTolerance: NSTimeInterval = 0.001
+    
+    private static let versionKey = "Version"
+    private static let entriesKey = "Entries"
+    private static let sizeKey = "Size"
+    private static let modificationDateKey = "ModificationDate"
+    private static let probeKey = "Probe"
+    
+    private var entries: [String : [String : AnyObject]] = [:]
+    private let saveQueue = dispatch_queue_create("MediaProbeIndex-Save", DISPATCH_QUEUE_SERIAL)
+    
+    init(indexPath: String) {
+        self.indexPath = indexPath
+        
+        if let index = NSDictionary(contentsOfFile: indexPath) as? [String : AnyObject]
+            where index[MediaProbeIndex.versionKey] as? Int == MediaProbeIndex.version {
+            entries = index[MediaProbeIndex.entriesKey] as? [String : [String : AnyObject]] ?? [:]
+        }
+    }
+    
+    /// Returns the indexed probe of the file at `path`, if it's up to date, without counting a hit or miss.
+    func indexedProbeForPath(path: String) -> MediaProbe? {
+        guard let entry = entries[path],
+            let identity = identityOfFile(path),
+            let modificationDate = entry[MediaProbeIndex.modificationDateKey] as? NSTimeInterval
+            where entry[MediaProbeIndex.sizeKey] as? NSNumber == identity.size && abs(modificationDate - identity.modificationDate) <= MediaProbeIndex.modificationDateTolerance,
+            let propertyList = entry[MediaProbeIndex.probeKey] as? [String : AnyObject] else {
+            return nil
+        }
+        
+        return MediaProbe(path: path, propertyList: propertyList)
+    }
+    
+    /// Returns the indexed probe of the file at `path`, or probes `media` and indexes the result.
+    func probeMedia(media: VLCMedia, path: String) -> MediaProbe {
+        defer {
+            if kOVCEnableDebugOutput {
+                print("Media probe index: \(hitCount) hits, \(missCount) misses")
+            }
+        }
+        
+        if let probe = indexedProbeForPath(path) {
+            hitCount += 1
+            return probe
+        }
+        
+        missCount += 1
+        
+        let probe = MediaProbe(media: media, path: path)
+        
+        if let identity = identityOfFile(path) {
+            entries[path] = [
+                MediaProbeIndex.sizeKey : identity.size,
+                MediaProbeIndex.modificationDateKey : identity.modificationDate,
+                MediaProbeIndex.probeKey : probe.propertyList,
+            ]
+            save()
+        }
+        
+        return probe
+    }
+}
+
+private extension MediaProbeIndex {
+    /// The file's size, and its modification date in seconds since 1970.
+    ///
+    /// Property lists keep dates to the whole second, while file systems keep them to fractions of one,
+    /// so a stored date would never match again. Seconds are kept as a real number instead.
+    func identityOfFile(path: String) -> (size: NSNumber, modificationDate: NSTimeInterval)? {
+        guard let attributes = try? NSFileManager.defaultManager().attributesOfItemAtPath(path),
+            let size = attributes[NSFileSize] as? NSNumber,
+            let modificationDate = attributes[NSFileModificationDate] as? NSDate else {
+            return nil
+        }
+        
+        return (size, modificationDate.timeIntervalSince1970)
+    }
+    
+    func save() {
+        let index: NSDictionary = [
+            MediaProbeIndex.versionKey : MediaProbeIndex.version,
+            MediaProbeIndex.entriesKey : entries,
+        ]
+        let indexPath = self.indexPath
+        
+        dispatch_async(saveQueue) {
+            if !index.writeToFile(indexPath, atomically: true) {
+                print("Couldn't save media probe index: \(indexPath)")
+            }
+        }
+    }
+}
@@ -0,0 +1,640 @@
+//
+//  ParallelConversionEngine.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+import VLCKit
+
+/**
+ Converts an input to HLS with several VLCKit sessions at once, each working on its own chunk of the input.
+ 
+ The input is split into chunks of `chunkDuration` seconds, which are converted in order
+ by up to `workerCount` sessions at a time. Each session decodes from the key frame at or before
+ its chunk's start, and starts encoding with a fresh key frame, so every chunk is independent.
+ 
+ Until the first segment is out, only the first chunk is converted, so it gets the whole machine
+ and playback can start as soon as possible.
+ 
+ Chunks that were completed by an earlier engine with the same paths are reused, rather than converted again.
+ 
+ With a `bitrateController`, each chunk's video bitrate is chosen when the chunk starts, from how fast
+ the receiver has been downloading, so later chunks adapt to the network. Chunks converted below the
+ full bitrate are named for their bitrate, so they aren't mistaken for full bitrate chunks on replay.
+ 
+ The chunks' playlists are stitched together, in order, into a single playlist at `playlistPath`,
+ with a discontinuity between chunks. Only chunks that are complete, followed by the segments
+ of the first chunk that isn't, are listed.
+ 
+ Seeking far past what's listed doesn't wait for the chunks in between. The chunk containing the
+ seek target is restarted from the target straight away, and spliced in after what's already listed,
+ with a discontinuity. The chunks in between are never listed, so from then on, playlist time runs
+ ahead of media time, and the two are converted with `playlistTimeForMediaTime(_:)` and
+ `mediaTimeForPlaylistTime(_:)`.
+ 
+ Complete chunks can have their segments discarded, to save disk space, while they stay listed.
+ `regenerateChunks(from:through:)` converts them again, at the bitrate they were first converted at,
+ so their segments come back under the same names, and each is moved into place as soon as it's finished.
+ */
+class ParallelConversionEngine: NSObject {
+    let inputPath: String
+    let duration: NSTimeInterval
+    let chunkDuration: NSTimeInterval
+    let workerCount: Int
+    
+    /// Options for VLCKit's transcode module, as given to `VLCStreamOutput`.
+    let transcodingOptions: [String : AnyObject]
+    let segmentDuration: UInt
+    
+    /// The stitched playlist.
+    let playlistPath: String
+    /// Chunk playlists and segments are written to this path prefix, followed by the chunk index.
+    let chunkPathPrefix: String
+    /// Chunk segments are listed under this URL prefix, followed by the chunk index.
+    let chunkURLPrefix: String
+    
+    let bitrateController: DeliveryBitrateController?
+    
+    /// `true` once every chunk has been converted.
+    private(set) var isComplete = false
+    /// Seconds from `start()` until the last chunk was converted.
+    private(set) var conversionTime: NSTimeInterval?
+    
+    /// How far into the input the stitched playlist reaches, in seconds.
+    var convertedPosition: NSTimeInterval {
+        return mediaTimeForPlaylistTime(listedDuration)
+    }
+    
+    /// `true` to pause the chunks being converted, and start no more until unpaused.
+    var isPaused = false {
+        didSet {
+            guard isPaused != oldValue else {
+                return
+            }
+            
+            for case let .converting(session) in chunkStates {
+                session.setConversionPaused(isPaused)
+            }
+            
+            startWaitingChunks()
+        }
+    }
+    
+    /// `false` if any chunk was converted below the full bitrate, skipped over by a seek, or discarded.
+    var outputIsReplayable: Bool {
+        return reducedChunkBitrates.isEmpty && splices.isEmpty && !discardedAnyChunk
+    }
+    
+    private enum ChunkState {
+        case waiting
+        case converting(VLCStreamSession)
+        case complete
+        /// Passed over by a seek, and never listed.
+        case skipped
+    }
+    
+    /// A point in the playlist where listing skipped ahead in the input.
+    private typealias Splice = (playlistTime: NSTimeInterval, mediaTime: NSTimeInterval)
+    
+    private var chunkStates: [ChunkState]
+    /// The video bitrate of each chunk converted below `transcodingOptions`' bitrate, in kilobits per second.
+    private var reducedChunkBitrates: [Int : Int] = [:]
+    /// Where each chunk that was restarted by a seek starts, if not at its usual start.
+    private var splicedChunkStartTimes: [Int : NSTimeInterval] = [:]
+    /// The number of playlist lines of each chunk that was cut short by a seek.
+    private var truncatedChunkLineCounts: [Int : Int] = [:]
+    private var splices: [Splice] = []
+    /// Complete chunks whose segments have been deleted, though they're still listed.
+    private var discardedChunkIndices: Set<Int> = []
+    private var discardedAnyChunk = false
+    /// Sessions converting discarded chunks again, by chunk index.
+    private var regeneratingChunks: [Int : VLCStreamSession] = [:]
+    /// Only one chunk is converted until this chunk, or one after it, has written a segment.
+    private var prioritizedChunkIndex = 0
+    /// The duration of the segments in the stitched playlist.
+    private var listedDuration: NSTimeInterval = 0
+    private var wroteFirstSegment = false
+    private var pollTimer: NSTimer?
+    private var startDate: NSDate?
+    
+    init(inputPath: String, duration: NSTimeInterval, chunkDuration: NSTimeInterval, workerCount: Int, transcodingOptions: [String : AnyObject], segmentDuration: UInt, playlistPath: String, chunkPathPrefix: String, chunkURLPrefix: String, bitrateController: DeliveryBitrateController?) {
+        self.inputPath = inputPath
+        self.duration = duration
+        self.chunkDuration = chunkDuration
+        self.workerCount = max(1, workerCount)
+        self.transcodingOptions = transcodingOptions
+        self.segmentDuration = segmentDuration
+        self.playlistPath = playlistPath
+        self.chunkPathPrefix = chunkPathPrefix
+        self.chunkURLPrefix = chunkURLPrefix
+        self.bitrateController = bitrateController
+        
+        let chunkCount = max(1, Int(ceil(duration / chunkDuration)))
+        chunkStates = [ChunkState](count: chunkCount, repeatedValue: .waiting)
+        
+        super.init()
+    }
+    
+    func start() {
+        guard startDate == nil else {
+            return
+        }
+        
+        startDate = NSDate()
+        
+        for index in chunkStates.indices where chunkPlaylistIsComplete(index) {
+            chunkStates[index] = .complete
+        }
+        
+        //  list any reused chunks right away
+        isComplete = allChunksComplete
+        writePlaylist()
+        
+        guard !isComplete else {
+            conversionTime = 0
+            return
+        }
+        
+        startWaitingChunks()
+        
+        pollTimer = NSTimer.scheduledTimerWithTimeInterval(kOVCParallelPollInterval, target: self, selector: #selector(ParallelConversionEngine.poll), userInfo: nil, repeats: true)
+    }
+    
+    func stop() {
+        pollTimer?.invalidate()
+        pollTimer = nil
+        
+        for (index, state) in chunkStates.enumerate() {
+            if case let .converting(session) = state {
+                session.stopStreaming()
+                chunkStates[index] = .waiting
+            }
+        }
+        
+        for session in regeneratingChunks.values {
+            session.stopStreaming()
+        }
+        regeneratingChunks.removeAll()
+    }
+    
+    /**
+     Delete the segments of the complete chunks that end before `mediaTime` in the input.
+     They stay listed, so a seek back to them needs `regenerateChunks(from:through:)`.
+     */
+    func discardChunks(endingBefore mediaTime: NSTimeInterval) {
+        let fileManager = NSFileManager.defaultManager()
+        
+        for (index, state) in chunkStates.enumerate() where chunkStopTime(index) <= mediaTime {
+            guard case .complete = state where !discardedChunkIndices.contains(index) && regeneratingChunks[index] == nil else {
+                continue
+            }
+            
+            for path in chunkSegmentPaths(index) {
+                _ = try? fileManager.removeItemAtPath(path)
+            }
+            
+            discardedChunkIndices.insert(index)
+            discardedAnyChunk = true
+        }
+    }
+    
+    /// Convert the discarded chunks that overlap `startTime` to `endTime` in the input again.
+    func regenerateChunks(from startTime: NSTimeInterval, through endTime: NSTimeInterval) {
+        for index in discardedChunkIndices.sort() where regeneratingChunks[index] == nil {
+            guard chunkStartTime(index) < endTime && chunkStopTime(index) > startTime else {
+                continue
+            }
+            
+            regeneratingChunks[index] = startSession(index, playlistPath: regeneratedChunkPlaylistPath(index), segmentPathPrefix: regeneratedSegmentPathPrefix)
+        }
+        
+        if pollTimer == nil && !regeneratingChunks.isEmpty {
+            pollTimer = NSTimer.scheduledTimerWithTimeInterval(kOVCParallelPollInterval, target: self, selector: #selector(ParallelConversionEngine.poll), userInfo: nil, repeats: true)
+        }
+    }
+    
+    /**
+     Convert the input from `mediaTime` on as soon as possible, and return the playlist time it will be listed at.
+     
+     Targets that are listed already, or are close enough that the chunk being listed will soon get there,
+     are left alone. Further ahead, the chunk containing the target is spliced in after what's listed.
+     */
+    func seek(mediaTime: NSTimeInterval) -> NSTimeInterval {
+        let target = min(max(mediaTime, 0), duration)
+        
+        guard let playlistTime = playlistTimeForMediaTime(target) else {
+            //  skipped over by an earlier seek, so continue from where listing picked up again
+            return splices.filter({ $0.mediaTime > target }).first?.playlistTime ?? listedDuration
+        }
+        
+        guard startDate != nil && !isComplete && playlistTime > listedDuration + kOVCSeekSpliceThreshold,
+            let listingIndex = chunkStates.indexOf({ !$0.isDone }) else {
+            return playlistTime
+        }
+        
+        //  a chunk can't be spliced into itself, but then it's less than a chunk away anyway
+        let targetIndex = min(Int(target / chunkDuration), chunkStates.count - 1)
+        guard targetIndex > listingIndex else {
+            return playlistTime
+        }
+        
+        //  keep what's been listed of the chunk being listed, and skip ahead to the target's chunk
+        if case let .converting(session) = chunkStates[listingIndex] {
+            session.stopStreaming()
+        }
+        
+        let listedLineCount = segmentLines(chunkPlaylistPath(listingIndex)).count
+        if listedLineCount > 0 {
+            truncatedChunkLineCounts[listingIndex] = listedLineCount
+            chunkStates[listingIndex] = .complete
+        } else {
+            chunkStates[listingIndex] = .skipped
+        }
+        
+        for index in (listingIndex + 1)..<targetIndex {
+            if case let .converting(session) = chunkStates[index] {
+                session.stopStreaming()
+            }
+            chunkStates[index] = .skipped
+        }
+        
+        //  a chunk that's already under way needn't be restarted
+        let spliceMediaTime: NSTimeInterval
+        if case .waiting = chunkStates[targetIndex] {
+            splicedChunkStartTimes[targetIndex] = target
+            chunkStates[targetIndex] = .converting(startChunk(targetIndex))
+            spliceMediaTime = target
+        } else {
+            spliceMediaTime = chunkStartTime(targetIndex)
+        }
+        
+        prioritizedChunkIndex = targetIndex
+        wroteFirstSegment = false
+        
+        //  the target's chunk may have segments listed already, so the splice is where they start
+        let splicePlaylistTime = playlistDurationBeforeChunk(targetIndex)
+        
+        writePlaylist()
+        splices.append((playlistTime: splicePlaylistTime, mediaTime: spliceMediaTime))
+        
+        if kOVCEnableDebugOutput {
+            print(String(format: "Seek to %.1f s spliced in at %.1f s of the playlist, skipping chunks %d to %d", target, splicePlaylistTime, listingIndex + 1, targetIndex - 1))
+        }
+        
+        return splicePlaylistTime + (target - spliceMediaTime)
+    }
+    
+    /// The time in the stitched playlist of `mediaTime` in the input, or `nil` if a seek skipped over it.
+    func playlistTimeForMediaTime(mediaTime: NSTimeInterval) -> NSTimeInterval? {
+        var listingStart: Splice = (playlistTime: 0, mediaTime: 0)
+        
+        for splice in splices {
+            let listingMediaEnd = listingStart.mediaTime + (splice.playlistTime - listingStart.playlistTime)
+            if mediaTime < listingMediaEnd {
+                break
+            }
+            
+            listingStart = splice
+        }
+        
+        guard mediaTime >= listingStart.mediaTime else {
+            return nil
+        }
+        
+        return listingStart.playlistTime + (mediaTime - listingStart.mediaTime)
+    }
+    
+    /// The time in the input of `playlistTime` in the stitched playlist.
+    func mediaTimeForPlaylistTime(playlistTime: NSTimeInterval) -> NSTimeInterval {
+        let listingStart = splices.filter({ $0.playlistTime <= playlistTime }).last ?? (playlistTime: 0, mediaTime: 0)
+        return listingStart.mediaTime + (playlistTime - listingStart.playlistTime)
+    }
+}
+
+private extension ParallelConversionEngine.ChunkState {
+    /// `true` if the chunk won't be converted any further.
+    var isDone: Bool {
+        switch self {
+        case .complete, .skipped:
+            return true
+        case .waiting, .converting:
+            return false
+        }
+    }
+}
+
+private extension ParallelConversionEngine {
+    var convertingCount: Int {
+        return chunkStates.filter {
+            if case .converting = $0 {
+                return true
+            }
+            return false
+        }.count
+    }
+    
+    var allChunksComplete: Bool {
+        return !chunkStates.contains { !$0.isDone }
+    }
+    
+    func chunkStartTime(index: Int) -> NSTimeInterval {
+        return splicedChunkStartTimes[index] ?? NSTimeInterval(index) * chunkDuration
+    }
+    
+    func chunkStopTime(index: Int) -> NSTimeInterval {
+        return min(NSTimeInterval(index + 1) * chunkDuration, duration)
+    }
+    
+    func chunkFilename(index: Int) -> String {
+        var filename = String(format: "%03d", index)
+        
+        if let startTime = splicedChunkStartTimes[index] {
+            filename += String(format: "-from%.0f", startTime * 1000)
+        }
+        if let bitrate = reducedChunkBitrates[index] {
+            filename += "-\(bitrate)k"
+        }
+        
+        return filename
+    }
+    
+    func chunkPlaylistPath(index: Int) -> String {
+        return "\(chunkPathPrefix)\(chunkFilename(index)).m3u8"
+    }
+    
+    /// Chunks regenerate into these paths, and each segment is moved to its usual path once it's finished.
+    var regeneratedSegmentPathPrefix: String {
+        return "\(chunkPathPrefix)regenerating-"
+    }
+    
+    func regeneratedChunkPlaylistPath(index: Int) -> String {
+        return "\(regeneratedSegmentPathPrefix)\(chunkFilename(index)).m3u8"
+    }
+    
+    /// A discarded chunk's playlist is still complete, but it can only be reused with every segment on disk.
+    func chunkPlaylistIsComplete(index: Int) -> Bool {
+        guard let playlist = try? String(contentsOfFile: chunkPlaylistPath(index), encoding: NSUTF8StringEncoding) else {
+            return false
+        }
+        
+        let fileManager = NSFileManager.defaultManager()
+        return playlist.containsString("#EXT-X-ENDLIST") && chunkSegmentPaths(index).reduce(true) { $0 && fileManager.fileExistsAtPath($1) }
+    }
+    
+    /// The paths of the segments in chunk `index`'s playlist.
+    func chunkSegmentPaths(index: Int) -> [String] {
+        return segmentLines(chunkPlaylistPath(index)).filter({ $0.hasPrefix(chunkURLPrefix) }).map { line in
+            chunkPathPrefix + line.substringFromIndex(line.startIndex.advancedBy(chunkURLPrefix.characters.count))
+        }
+    }
+    
+    /// Move the segments a regenerating chunk has finished to their usual paths.
+    func moveRegeneratedSegments(index: Int) {
+        let fileManager = NSFileManager.defaultManager()
+        
+        for line in segmentLines(regeneratedChunkPlaylistPath(index)) where line.hasPrefix(chunkURLPrefix) {
+            let filename = line.substringFromIndex(line.startIndex.advancedBy(chunkURLPrefix.characters.count))
+            let regeneratedPath = regeneratedSegmentPathPrefix + filename
+            
+            guard fileManager.fileExistsAtPath(regeneratedPath) else {
+                continue
+            }
+            
+            let path = chunkPathPrefix + filename
+            do {
+                _ = try? fileManager.removeItemAtPath(path)
+                try fileManager.moveItemAtPath(regeneratedPath, toPath: path)
+            } catch {
+                print("Couldn't move regenerated segment: \(regeneratedPath), \(error)")
+            }
+        }
+    }
+    
+    //  start the earliest waiting chunks, as they're needed first
+    func startWaitingChunks() {
+        guard !isPaused else {
+            return
+        }
+        
+        let availableWorkers = wroteFirstSegment ? workerCount : 1
+        
+        for (index, state) in chunkStates.enumerate() {
+            guard convertingCount < availableWorkers else {
+                return
+            }
+            
+            if case .waiting = state {
+                chunkStates[index] = .converting(startChunk(index))
+            }
+        }
+    }
+    
+    func startChunk(index: Int) -> VLCStreamSession {
+        reducedChunkBitrates[index] = bitrateController?.reducedVideoBitrate(transcodingOptions)
+        if let bitrate = reducedChunkBitrates[index] where kOVCEnableDebugOutput {
+            print("Converting chunk \(index) at \(bitrate) kb/s, to fit measured goodput of \(bitrateController?.measuredGoodput ?? 0) kb/s")
+        }
+        
+        return startSession(index, playlistPath: chunkPlaylistPath(index), segmentPathPrefix: chunkPathPrefix)
+    }
+    
+    /// Start converting chunk `index` at the bitrate it was given, with its playlist and segments written to the given paths.
+    func startSession(index: Int, playlistPath: String, segmentPathPrefix: String) -> VLCStreamSession {
+        let media = VLCMedia(path: inputPath)
+        media.addOptions([
+            "start-time" : chunkStartTime(index),
+            "stop-time" : chunkStopTime(index),
+            ])
+        
+        var chunkTranscodingOptions = transcodingOptions
+        if let bitrate = reducedChunkBitrates[index] {
+            chunkTranscodingOptions["videoBitrate"] = "\(bitrate)"
+        }
+        
+        let chunkPrefix = "\(chunkFilename(index))-"
+        let segmentTemplate = "\(segmentPathPrefix)\(chunkPrefix)#####.\(kOVCHLSOutputFiletype)"
+        let segmentURLTemplate = "\(chunkURLPrefix)\(chunkPrefix)#####.\(kOVCHLSOutputFiletype)"
+        
+        let access = "livehttp{seglen=\(segmentDuration),delsegs=false,index=\(playlistPath),index-url=\(segmentURLTemplate)}"
+        let outputOptions = [
+            "access" : access,
+            "muxer" : "\(kOVCHLSOutputFiletype){use-key-frames}",
+            "destination" : segmentTemplate,
+        ]
+        
+        let session = VLCStreamSession()
+        session.media = media
+        session.streamOutput = VLCStreamOutput(optionDictionary: [
+            "transcodingOptions" : chunkTranscodingOptions,
+            "outputOptions" : outputOptions,
+            ])
+        session.startStreaming()
+        
+        return session
+    }
+    
+    @objc func poll() {
+        for (index, state) in chunkStates.enumerate() {
+            if case let .converting(session) = state where session.isComplete {
+                session.stopStreaming()
+                chunkStates[index] = .complete
+            }
+        }
+        
+        startWaitingChunks()
+        
+        for (index, session) in regeneratingChunks {
+            moveRegeneratedSegments(index)
+            
+            if session.isComplete {
+                session.stopStreaming()
+                moveRegeneratedSegments(index)
+                _ = try? NSFileManager.defaultManager().removeItemAtPath(regeneratedChunkPlaylistPath(index))
+                
+                regeneratingChunks[index] = nil
+                discardedChunkIndices.remove(index)
+            }
+        }
+        
+        isComplete = allChunksComplete
+        
+        writePlaylist()
+        
+        if isComplete && conversionTime == nil {
+            conversionTime = startDate.map { NSDate().timeIntervalSinceDate($0) }
+        }
+        
+        if isComplete && regeneratingChunks.isEmpty {
+            pollTimer?.invalidate()
+            pollTimer = nil
+        }
+    }
+    
+    func writePlaylist() {
+        var lines: [String] = []
+        
+        var playlistDuration: NSTimeInterval = 0
+        var longestSegmentDuration: NSTimeInterval = 0
+        
+        for (index, state) in chunkStates.enumerate() {
+            if case .waiting = state {
+                break
+            }
+            if case .skipped = state {
+                continue
+            }
+            
+            let chunkLines = listedSegmentLines(index)
+            
+            if index > 0 && !chunkLines.isEmpty {
+                lines.append("#EXT-X-DISCONTINUITY")
+            }
+            lines.appendContentsOf(chunkLines)
+            
+            for segmentDuration in segmentDurations(chunkLines) {
+                playlistDuration += segmentDuration
+                longestSegmentDuration = max(longestSegmentDuration, segmentDuration)
+            }
+            
+            if !chunkLines.isEmpty && index >= prioritizedChunkIndex {
+                wroteFirstSegment = true
+            }
+            
+            //  later chunks can't be listed until this one is complete
+            guard case .complete = state else {
+                break
+            }
+        }
+        
+        if isComplete {
+            lines.append("#EXT-X-ENDLIST")
+        }
+        
+        listedDuration = playlistDuration
+        
+        //  every listed segment's duration must round to at most the target duration.
+        //  segments are cut on forced key frames, so they shouldn't run past the segment duration.
+        let targetDuration = max(Int(segmentDuration), Int(round(longestSegmentDuration)))
+        let header = [
+            "#EXTM3U",
+            "#EXT-X-VERSION:3",
+            "#EXT-X-TARGETDURATION:\(targetDuration)",
+            "#EXT-X-MEDIA-SEQUENCE:0",
+        ]
+        
+        let playlist = (header + lines).joinWithSeparator("\n") + "\n"
+        
+        do {
+            try playlist.writeToFile(playlistPath, atomically: true, encoding: NSUTF8StringEncoding)
+        } catch {
+            print("Couldn't write stitched HLS playlist: \(playlistPath), \(error)")
+        }
+    }
+    
+    /// The duration of what the playlist lists before chunk `chunkIndex`, i.e. where its segments start.
+    func playlistDurationBeforeChunk(chunkIndex: Int) -> NSTimeInterval {
+        var duration: NSTimeInterval = 0
+        
+        for (index, state) in chunkStates.prefix(chunkIndex).enumerate() {
+            if case .waiting = state {
+                break
+            }
+            if case .skipped = state {
+                continue
+            }
+            
+            duration += segmentDurations(listedSegmentLines(index)).reduce(0, combine: +)
+            
+            guard case .complete = state else {
+                break
+            }
+        }
+        
+        return duration
+    }
+    
+    /// The segment lines of chunk `index` that the playlist lists, which a seek may have cut short.
+    func listedSegmentLines(index: Int) -> [String] {
+        let lines = segmentLines(chunkPlaylistPath(index))
+        
+        guard let lineCount = truncatedChunkLineCounts[index] else {
+            return lines
+        }
+        
+        return Array(lines.prefix(lineCount))
+    }
+    
+    /// The durations of the segments in `segmentLines`, from their EXTINF lines.
+    func segmentDurations(segmentLines: [String]) -> [NSTimeInterval] {
+        return segmentLines.filter({ $0.hasPrefix("#EXTINF:") }).map { line in
+            let value = line.substringFromIndex(line.startIndex.advancedBy("#EXTINF:".characters.count))
+            return value.componentsSeparatedByString(",").first.flatMap({ Double($0) }) ?? 0
+        }
+    }
+    
+    /// The EXTINF and URI lines of every segment in a chunk's playlist.
+    func segmentLines(chunkPlaylistPath: String) -> [String] {
+        guard let playlist = try? String(contentsOfFile: chunkPlaylistPath, encoding: NSUTF8StringEncoding) else {
+            return []
+        }
+        
+        var lines: [String] = []
+        var extinf: String?
+        
+        for line in playlist.componentsSeparatedByCharactersInSet(NSCharacterSet.newlineCharacterSet()) {
+            if line.hasPrefix("#EXTINF:") {
+                extinf = line
+            } else if let segmentExtinf = extinf where !line.isEmpty && !line.hasPrefix("#") {
+                lines.append(segmentExtinf)
+                lines.append(line)
+                extinf = nil
+            }
+        }
+        
+        return lines
+    }
+}
@@ -0,0 +1,199 @@
+//
+//  SegmentStore.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/**
+ An in-memory store of HLS segments, which the HTTP server serves without going back to disk.
+ 
+ Segments are added as the converter finishes them, and the least recently used segments
+ are evicted once the store grows past its capacity. Every segment is also on disk, so
+ evicted segments are simply served from there.
+ 
+ All methods are thread-safe.
+ */
+class SegmentStore: NSObject, HTTPDataStore {
+    /// The most bytes of segment data to hold in memory at once.
+    let capacity: Int
+    
+    private let queue = dispatch_queue_create("SegmentStore", DISPATCH_QUEUE_SERIAL)
+    private let ingestQueue = dispatch_queue_create("SegmentStore-Ingest", DISPATCH_QUEUE_SERIAL)
+    
+    private var segments: [String : StoredSegment] = [:]
+    /// Ends of the list of stored segments, which runs from least to most recently used.
+    private var leastRecentlyUsed: StoredSegment?
+    private var mostRecentlyUsed: StoredSegment?
+    private var storedBytes: Int = 0
+    
+    /// Paths of segments that have been ingested from a playlist, whether or not they're still stored.
+    private var ingestedPaths: Set<String> = []
+    
+    init(capacity: Int) {
+        self.capacity = capacity
+        
+        super.init()
+    }
+    
+    /**
+     Add a segment to the store, evicting older segments as needed to stay within `capacity`.
+     Segments larger than `capacity` aren't stored.
+     */
+    func storeSegment(data: NSData, forFilePath filePath: String) {
+        let key = (filePath as NSString).stringByStandardizingPath
+        
+        dispatch_sync(queue) {
+            guard data.length <= self.capacity else {
+                return
+            }
+            
+            self.removeSegment(key)
+            
+            while let evicted = self.leastRecentlyUsed where self.storedBytes + data.length > self.capacity {
+                self.removeSegment(evicted.path)
+            }
+            
+            let segment = StoredSegment(path: key, data: data)
+            self.segments[key] = segment
+            self.appendSegment(segment)
+            self.storedBytes += data.length
+        }
+    }
+    
+    /**
+     Read every segment listed in an HLS playlist that hasn't been read before, and store it.
+     
+     Segments are only listed once the converter has finished writing them, so this is safe to call
+     while the conversion is still running. Reading happens in the background.
+     
+     Only for output nothing hands segments to the store as they're made, e.g. output kept from an earlier session.
+     */
+    func ingestSegmentsListedInPlaylist(playlistPath: String) {
+        dispatch_async(ingestQueue) {
+            guard let playlist = try? String(contentsOfFile: playlistPath, encoding: NSUTF8StringEncoding) else {
+                return
+            }
+            
+            let directory = (playlistPath as NSString).stringByDeletingLastPathComponent
+            
+            for line in playlist.componentsSeparatedByCharactersInSet(NSCharacterSet.newlineCharacterSet()) {
+                // Everything other than tags and blank lines is a segment URI
+                guard !line.isEmpty && !line.hasPrefix("#") else {
+                    continue
+                }
+                
+                let filename = (line as NSString).lastPathComponent
+                let segmentPath = ((directory as NSString).stringByAppendingPathComponent(filename) as NSString).stringByStandardizingPath
+                
+                var alreadyIngested = false
+                dispatch_sync(self.queue) {
+                    alreadyIngested = self.ingestedPaths.contains(segmentPath)
+                    self.ingestedPaths.insert(segmentPath)
+                }
+                
+                guard !alreadyIngested, let data = NSData(contentsOfFile: segmentPath) else {
+                    continue
+                }
+                
+                self.storeSegment(data, forFilePath: segmentPath)
+            }
+        }
+    }
+    
+    func removeSegmentForFilePath(filePath: String) {
+        let key = (filePath as NSString).stringByStandardizingPath
+        
+        dispatch_sync(queue) {
+            self.removeSegment(key)
+        }
+    }
+    
+    func removeAllSegments() {
+        dispatch_sync(queue) {
+            self.segments.removeAll()
+            self.leastRecentlyUsed = nil
+            self.mostRecentlyUsed = nil
+            self.ingestedPaths.removeAll()
+            self.storedBytes = 0
+        }
+    }
+    
+    // MARK: HTTPDataStore
+    
+    func dataForFilePath(filePath: String) -> NSData? {
+        var data: NSData?
+        
+        dispatch_sync(queue) {
+            guard let segment = self.segments[filePath] else {
+                return
+            }
+            
+            self.unlinkSegment(segment)
+            self.appendSegment(segment)
+            data = segment.data
+        }
+        
+        return data
+    }
+}
+
+/// A stored segment, linked into the store's list of segments by how recently they were used.
+private class StoredSegment {
+    let path: String
+    let data: NSData
+    
+    weak var previous: StoredSegment?
+    var next: StoredSegment?
+    
+    init(path: String, data: NSData) {
+        self.path = path
+        self.data = data
+    }
+}
+
+private extension SegmentStore {
+    /// Must be called on `queue`.
+    func removeSegment(filePath: String) {
+        guard let segment = segments.removeValueForKey(filePath) else {
+            return
+        }
+        
+        storedBytes -= segment.data.length
+        unlinkSegment(segment)
+    }
+    
+    /// Link `segment` in as the most recently used. Must be called on `queue`.
+    func appendSegment(segment: StoredSegment) {
+        segment.previous = mostRecentlyUsed
+        segment.next = nil
+        
+        mostRecentlyUsed?.next = segment
+        mostRecentlyUsed = segment
+        
+        if leastRecentlyUsed == nil {
+            leastRecentlyUsed = segment
+        }
+    }
+    
+    /// Must be called on `queue`.
+    func unlinkSegment(segment: StoredSegment) {
+        if let previous = segment.previous {
+            previous.next = segment.next
+        } else if leastRecentlyUsed === segment {
+            leastRecentlyUsed = segment.next
+        }
+        
+        if let next = segment.next {
+            next.previous = segment.previous
+        } else if mostRecentlyUsed === segment {
+            mostRecentlyUsed = segment.previous
+        }
+        
+        segment.previous = nil
+        segment.next = nil
+    }
+}
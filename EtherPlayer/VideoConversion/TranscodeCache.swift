@@ -0,0 +1,232 @@
+//
+//  TranscodeCache.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/**
+ Keeps conversion output around, so replaying a file doesn't convert it all over again.
+ 
+ Each entry is a directory under `directoryPath`, named for a key made from a fingerprint of
+ the input's content and the settings that decide how it's converted. Given the same input,
+ the same settings always produce the same transcoding options, so the key covers both.
+ 
+ Entries are evicted least recently used first, once the cache grows past `budget` bytes.
+ */
+class TranscodeCache {
+    /**
+     A directory of conversion output for a single input and set of settings.
+     */
+    class Entry {
+        let key: String
+        /// Where the output is written, with a trailing slash.
+        let directoryPath: String
+        /// The directory's path relative to the cache's parent directory, with a trailing slash.
+        let relativePath: String
+        
+        /// A stable session ID for naming output files, so they're found again on replay.
+        var sessionID: UInt32 {
+            return UInt32(key.substringToIndex(key.startIndex.advancedBy(8)), radix: 16) ?? 0
+        }
+        
+        /// `true` if the output in this entry is complete, and can be served as it is.
+        var isComplete: Bool {
+            return manifest()?[Entry.completeKey] as? Bool ?? false
+        }
+        
+        private static let manifestFilename = "Entry.plist"
+        private static let completeKey = "Complete"
+        private static let lastUsedKey = "LastUsed"
+        
+        private var manifestPath: String {
+            return directoryPath.stringByAppendingString(Entry.manifestFilename)
+        }
+        
+        private init(key: String, directoryPath: String, relativePath: String) {
+            self.key = key
+            self.directoryPath = directoryPath
+            self.relativePath = relativePath
+        }
+        
+        /// Record that the output in this entry is complete.
+        func markComplete() {
+            writeManifest(complete: true)
+        }
+        
+        /// Record that this entry was just used.
+        func touch() {
+            writeManifest(complete: isComplete)
+        }
+        
+        private func manifest() -> [String : AnyObject]? {
+            return NSDictionary(contentsOfFile: manifestPath) as? [String : AnyObject]
+        }
+        
+        private func writeManifest(complete complete: Bool) {
+            let manifest: NSDictionary = [
+                Entry.completeKey : complete,
+                Entry.lastUsedKey : NSDate(),
+            ]
+            
+            if !manifest.writeToFile(manifestPath, atomically: true) {
+                print("Couldn't write transcode cache manifest: \(manifestPath)")
+            }
+        }
+        
+        private var lastUsedDate: NSDate {
+            return manifest()?[Entry.lastUsedKey] as? NSDate ?? NSDate.distantPast()
+        }
+    }
+    
+    /// Where entries are kept, with a trailing slash.
+    let directoryPath: String
+    /// The most bytes of output to keep, across all entries.
+    let budget: UInt64
+    
+    private let evictionQueue = dispatch_queue_create("TranscodeCache-Eviction", DISPATCH_QUEUE_SERIAL)
+    private let fingerprintQueue = dispatch_queue_create("TranscodeCache-Fingerprint", DISPATCH_QUEUE_SERIAL)
+    
+    /// The number of bytes of each input's start and end that go into its fingerprint.
+    private let fingerprintSampleLength = 1024 * 1024
+    
+    init(directoryPath: String, budget: UInt64) {
+        self.directoryPath = directoryPath.hasSuffix("/") ? directoryPath : directoryPath + "/"
+        self.budget = budget
+        
+        do {
+            try NSFileManager.defaultManager().createDirectoryAtPath(self.directoryPath, withIntermediateDirectories: true, attributes: nil)
+        } catch {
+            print("Couldn't create transcode cache directory: \(self.directoryPath), \(error)")
+        }
+    }
+    
+    /**
+     Returns the entry for converting the file at `inputPath` with the given settings,
+     creating its directory if it doesn't exist yet. Returns `nil` if the file can't be read.
+     
+     `settings` should describe everything, other than the input, that changes the output.
+     */
+    func entryForInput(inputPath: String, settings: String) -> Entry? {
+        guard let fingerprint = fingerprintOfFile(inputPath) else {
+            return nil
+        }
+        
+        let key = sha1HexString("\(fingerprint)|\(settings)".dataUsingEncoding(NSUTF8StringEncoding)!)
+        let relativePath = "\((directoryPath as NSString).lastPathComponent)/\(key)/"
+        let entry = Entry(key: key, directoryPath: directoryPath + key + "/", relativePath: relativePath)
+        
+        do {
+            try NSFileManager.defaultManager().createDirectoryAtPath(entry.directoryPath, withIntermediateDirectories: true, attributes: nil)
+        } catch {
+            print("Couldn't create transcode cache entry: \(entry.directoryPath), \(error)")
+            return nil
+        }
+        
+        entry.touch()
+        
+        return entry
+    }
+    
+    /**
+     Look up the entry for converting the file at `inputPath` in the background, as `entryForInput(_:settings:)` does,
+     since fingerprinting the file reads a couple of megabytes of it. `completion` is called on the main queue.
+     */
+    func fetchEntryForInput(inputPath: String, settings: String, completion: (Entry?) -> Void) {
+        dispatch_async(fingerprintQueue) {
+            let entry = self.entryForInput(inputPath, settings: settings)
+            
+            dispatch_async(dispatch_get_main_queue()) {
+                completion(entry)
+            }
+        }
+    }
+    
+    /**
+     Delete the least recently used entries until the cache fits within its budget.
+     `keptEntries` are never deleted, as they're in use. Deleting happens in the background.
+     */
+    func evictEntries(keeping keptEntries: [Entry]) {
+        let keptKeys = Set(keptEntries.map { $0.key })
+        
+        dispatch_async(evictionQueue) {
+            let fileManager = NSFileManager.defaultManager()
+            
+            guard let keys = try? fileManager.contentsOfDirectoryAtPath(self.directoryPath) else {
+                return
+            }
+            
+            var entries = keys.map { key -> (entry: Entry, size: UInt64) in
+                let entry = Entry(key: key, directoryPath: self.directoryPath + key + "/", relativePath: "")
+                return (entry, self.sizeOfDirectory(entry.directoryPath))
+            }
+            
+            var totalSize = entries.reduce(0) { $0 + $1.size }
+            
+            entries.sortInPlace { $0.entry.lastUsedDate.compare($1.entry.lastUsedDate) == .OrderedAscending }
+            
+            for (entry, size) in entries where totalSize > self.budget && !keptKeys.contains(entry.key) {
+                do {
+                    try fileManager.removeItemAtPath(entry.directoryPath)
+                    totalSize -= size
+                } catch {
+                    print("Couldn't evict transcode cache entry: \(entry.directoryPath), \(error)")
+                }
+            }
+        }
+    }
+}
+
+private extension TranscodeCache {
+    /// Identifies a file by its size, and the content at its start and end.
+    func fingerprintOfFile(path: String) -> String? {
+        guard let fileHandle = NSFileHandle(forReadingAtPath: path) else {
+            return nil
+        }
+        
+        defer {
+            fileHandle.closeFile()
+        }
+        
+        let fileLength = fileHandle.seekToEndOfFile()
+        let sampleLength = UInt64(fingerprintSampleLength)
+        
+        let sample = NSMutableData()
+        
+        fileHandle.seekToFileOffset(0)
+        sample.appendData(fileHandle.readDataOfLength(fingerprintSampleLength))
+        
+        if fileLength > sampleLength {
+            fileHandle.seekToFileOffset(max(sampleLength, fileLength - sampleLength))
+            sample.appendData(fileHandle.readDataToEndOfFile())
+        }
+        
+        return "\(fileLength)-\(sha1HexString(sample))"
+    }
+    
+    func sha1HexString(data: NSData) -> String {
+        var digest = [UInt8](count: Int(CC_SHA1_DIGEST_LENGTH), repeatedValue: 0)
+        CC_SHA1(data.bytes, CC_LONG(data.length), &digest)
+        
+        return digest.map { String(format: "%02x", $0) }.joinWithSeparator("")
+    }
+    
+    func sizeOfDirectory(path: String) -> UInt64 {
+        guard let enumerator = NSFileManager.defaultManager().enumeratorAtPath(path) else {
+            return 0
+        }
+        
+        var size: UInt64 = 0
+        
+        while let _ = enumerator.nextObject() {
+            if let fileSize = enumerator.fileAttributes?[NSFileSize] as? NSNumber {
+                size += fileSize.unsignedLongLongValue
+            }
+        }
+        
+        return size
+    }
+}
@@ -0,0 +1,86 @@
+//
+//  TranscodePacingGovernor.swift
+//  EtherPlayer
+//
+//  Created by agent on 10/17/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+import VLCKit
+
+/**
+ Keeps a conversion a few segments ahead of the receiver, rather than running flat out until the input ends.
+ 
+ The conversion is paused once it's `maximumLead` seconds ahead of the receiver's playback position,
+ and resumed at full speed once the receiver has caught up to within `minimumLead` seconds of it.
+ The gap between the two keeps a resumed conversion running long enough to be worth resuming.
+ 
+ Positions are in the input, and until the receiver reports one, it's taken to be at the start.
+ */
+class TranscodePacingGovernor {
+    var maximumLead: NSTimeInterval
+    var minimumLead: NSTimeInterval
+    
+    var playbackPosition: NSTimeInterval = 0
+    
+    /// `true` to keep the conversion paused whatever its lead, such as while something more important needs the processors.
+    var isHeld = false
+    
+    private(set) var isPaused = false
+    
+    /// Total seconds the conversion has spent paused.
+    var pausedDuration: NSTimeInterval {
+        return completedPausesDuration + (pauseDate.map { NSDate().timeIntervalSinceDate($0) } ?? 0)
+    }
+    
+    private var completedPausesDuration: NSTimeInterval = 0
+    private var pauseDate: NSDate?
+    
+    init(maximumLead: NSTimeInterval, minimumLead: NSTimeInterval) {
+        self.maximumLead = maximumLead
+        self.minimumLead = min(minimumLead, maximumLead)
+    }
+    
+    /// Update `isPaused` for a conversion that has reached `convertedPosition`, and return `true` if it changed.
+    func update(convertedPosition: NSTimeInterval) -> Bool {
+        let lead = convertedPosition - playbackPosition
+        let shouldPause = isHeld || (isPaused ? lead > minimumLead : lead >= maximumLead)
+        
+        guard shouldPause != isPaused else {
+            return false
+        }
+        
+        isPaused = shouldPause
+        
+        if isPaused {
+            pauseDate = NSDate()
+        } else if let pauseDate = pauseDate {
+            completedPausesDuration += NSDate().timeIntervalSinceDate(pauseDate)
+            self.pauseDate = nil
+        }
+        
+        if kOVCEnableDebugOutput {
+            print(String(format: "%@ conversion %.1f s ahead of playback at %.1f s", isPaused ? "Paused" : "Resumed", lead, playbackPosition))
+        }
+        
+        return true
+    }
+}
+
+extension VLCStreamSession {
+    /// How far into the input the session has read, in seconds.
+    var convertedPosition: NSTimeInterval {
+        return (time.value?.doubleValue ?? 0) / 1000
+    }
+    
+    /// Pause or resume a started session. A paused session keeps its place in the input and the output.
+    func setConversionPaused(paused: Bool) {
+        if paused && playing {
+            pause()
+        } else if !paused && state == .Paused {
+            play()
+        }
+    }
+}
@@ -25,14 +25,23 @@ class VideoConversionStateMachine: GKStateMachine {
     
     struct Metadata {
         var duration: Double {
+            if let probedDuration = probedDuration {
+                return probedDuration
+            }
+            
             let len = inputMedia.length
             let intVal = len.intValue
             return Double(intVal) / 1000
         }
         
+        let sessionID: UInt32
         let conversionType: ConversionType
+        let inputPath: String
         let inputMedia: VLCMedia
         
+        /// The duration from an indexed probe of the input, in which case it doesn't need to be parsed.
+        let probedDuration: Double?
+        
         var outputVideoFilenameOrTemplate: String {
             switch conversionType {
             case let .httpLiveStreaming(m3u8Filename: _, filenameTemplate: template):
@@ -49,21 +58,25 @@ class VideoConversionStateMachine: GKStateMachine {
         let allowHLS: Bool
         let conversionType: ConversionType
         
-        init(sessionID: UInt32, mediaPath: String, allowHLS: Bool) {
-            self.sessionID = sessionID
-            self.allowHLS = allowHLS
-            
-            let workingPath: String
+        /// The file path of the media at `mediaPath`, which may be a file URL.
+        static func inputPathForMediaPath(mediaPath: String) -> String {
             if let _ = mediaPath.rangeOfString("file://localhost") {
                 let nonURL = mediaPath.stringByReplacingOccurrencesOfString("file://localhost", withString: "")
                 guard let unencoded = nonURL.stringByRemovingPercentEncoding else {
                     fatalError("Couldn't remove percent encodes from path \(mediaPath)")
                 }
                 
-                workingPath = unencoded
+                return unencoded
             } else {
-                workingPath = mediaPath
+                return mediaPath
             }
+        }
+        
+        init(sessionID: UInt32, mediaPath: String, allowHLS: Bool, probeIndex: MediaProbeIndex?) {
+            self.sessionID = sessionID
+            self.allowHLS = allowHLS
+            
+            let workingPath = ReadyState.inputPathForMediaPath(mediaPath)
             
             if allowHLS {
                 let outputStreamFilename = "\(sessionID)-#####.\(kOVCHLSOutputFiletype)"
@@ -75,7 +88,8 @@ class VideoConversionStateMachine: GKStateMachine {
             }
             
             let inputMedia = VLCMedia(path: workingPath)
-            metadata = Metadata(conversionType: conversionType, inputMedia: inputMedia)
+            let probedDuration = probeIndex?.indexedProbeForPath(workingPath)?.duration
+            metadata = Metadata(sessionID: sessionID, conversionType: conversionType, inputPath: workingPath, inputMedia: inputMedia, probedDuration: probedDuration)
         }
         
         override func isValidNextState(stateClass: AnyClass) -> Bool {
@@ -88,7 +102,7 @@ class VideoConversionStateMachine: GKStateMachine {
         let completion: () -> Void
         
         private var alreadyParsed: Bool {
-            return metadata.inputMedia.isParsed
+            return metadata.inputMedia.isParsed || metadata.probedDuration != nil
         }
         private var isCancelled = false
         
@@ -103,7 +117,7 @@ class VideoConversionStateMachine: GKStateMachine {
         
         override func didEnterWithPreviousState(previousState: GKState?) {
             guard !alreadyParsed else {
-                print("Our VLCMedia object is already parsed.")
+                print("Our VLCMedia object is already parsed, or its probe is indexed.")
                 completion()
                 return
             }
@@ -128,9 +142,54 @@ class VideoConversionStateMachine: GKStateMachine {
     }
     
     class ConvertingState: GKState {
+        /// How much sooner the output was found ready than by polling for it on a timer.
+        struct ReadinessMeasurement {
+            /// Seconds from the start of the conversion until the output was found ready.
+            let timeToReady: NSTimeInterval
+            /// Seconds until the timer that used to poll for the output would have found it ready.
+            let polledTimeToReady: NSTimeInterval
+            
+            var savedLatency: NSTimeInterval {
+                return polledTimeToReady - timeToReady
+            }
+        }
+        
+        /// How quickly the input was converted.
+        struct ConversionReport {
+            let mediaDuration: NSTimeInterval
+            let conversionTime: NSTimeInterval
+            /// Number of VLCKit sessions that converted at once.
+            let workerCount: Int
+            
+            /// Seconds of media converted per second, e.g. 4 for four times faster than realtime.
+            var realtimeFactor: Double {
+                return conversionTime > 0 ? mediaDuration / conversionTime : 0
+            }
+        }
+        
+        /// The master playlist of an adaptive bitrate conversion, and the renditions listed in it besides the main one.
+        struct AdaptiveOutput {
+            let masterPlaylistPath: String
+            let variants: [HLSRendition.Variant]
+            /// Empty if the output is being reused.
+            let renditions: [HLSRendition]
+            let renditionPlaylistPaths: [String]
+        }
+        
         let metadata: Metadata
         
-        let session: VLCStreamSession
+        /// The VLCKit session doing the conversion, or `nil` if the input is played directly
+        /// or converted in parallel.
+        let session: VLCStreamSession?
+        
+        /// Converts the input in chunks, if it's worth doing so.
+        let parallelEngine: ParallelConversionEngine?
+        
+        /// Where the output is kept for replays, if anywhere.
+        let cacheEntry: TranscodeCache.Entry?
+        
+        /// Whether the output is already complete from an earlier session, so there's nothing to convert.
+        let reusingOutput: Bool
         let outputStreamPath: String
         
         /**
@@ -140,16 +199,73 @@ class VideoConversionStateMachine: GKStateMachine {
         
         let usingHLS: Bool
         
+        /// Whether the input file is served as it is, rather than converted.
+        let playingDirectly: Bool
+        
+        /// Where finished HLS segments are kept in memory for serving, if anywhere.
+        let segmentStore: SegmentStore?
+        
+        /// Joins livehttp's segments into the served HLS playlist, if using HLS.
+        let segmentScheduler: HLSSegmentScheduler?
+        
+        /// Lower bitrate renditions for receivers to switch to, if using HLS with adaptive bitrate.
+        let adaptiveOutput: AdaptiveOutput?
+        
+        /// Pauses the conversion while it's far ahead of the receiver, if it's paced.
+        let pacingGovernor: TranscodePacingGovernor?
+        
+        /// `true` while the input is only being converted ahead of its turn in the play queue,
+        /// until `beginPlayback()`. Only its opening is converted, and only while the processors have time to spare.
+        private(set) var isPreconverting: Bool
+        
         weak var delegate: ConvertingStateDelegate?
         
-        init(metadata: Metadata, baseHTTPAddress: String, baseFilePath: String) {
+        /// Set once the output is ready.
+        private(set) var readinessMeasurement: ReadinessMeasurement?
+        
+        /// Set once the conversion is complete.
+        private(set) var conversionReport: ConversionReport?
+        
+        private var directoryWatcher: FileSystemWatcher?
+        private var ingestTimer: NSTimer?
+        private var completionTimer: NSTimer?
+        private var pacingTimer: NSTimer?
+        private(set) var outputReady = false
+        private var hasEntered = false
+        private var conversionStarted = false
+        private let hostCPULoad = HostCPULoad()
+        private var streamingStartDate = NSDate()
+        
+        init(metadata: Metadata, baseHTTPAddress: String, baseFilePath: String, segmentStore: SegmentStore?, cacheEntry: TranscodeCache.Entry?, probeIndex: MediaProbeIndex?, bitrateController: DeliveryBitrateController?, preconverting: Bool) {
             self.metadata = metadata
+            self.isPreconverting = preconverting
+            self.segmentStore = segmentStore
+            self.cacheEntry = cacheEntry
             
             let inputMedia = metadata.inputMedia
+            let probe = probeIndex?.probeMedia(inputMedia, path: metadata.inputPath) ?? MediaProbe(media: inputMedia, path: metadata.inputPath)
+            
+            //  serve files that AirPlay devices can already play straight from where they are
+            if kOVCAllowDirectPlay && probe.isDirectPlayable, let filename = ConvertingState.linkInputFile(metadata, baseFilePath: baseFilePath) {
+                session = nil
+                parallelEngine = nil
+                outputStreamPath = baseFilePath.stringByAppendingString(filename)
+                mainFileURL = baseHTTPAddress.stringByAppendingString(filename)
+                usingHLS = false
+                playingDirectly = true
+                reusingOutput = false
+                segmentScheduler = nil
+                adaptiveOutput = nil
+                pacingGovernor = nil
+                
+                super.init()
+                return
+            }
             
-            // Maybe the wrong initializer for VLCStreamSession?
-            session = VLCStreamSession()
-            session.media = inputMedia
+            playingDirectly = false
+            
+            let reuseOutput = cacheEntry?.isComplete ?? false
+            reusingOutput = reuseOutput
             
             //  AAC is 1630826605
             //  MP3 is 1634168941
@@ -184,7 +300,7 @@ class VideoConversionStateMachine: GKStateMachine {
             var width: String?
             var subs: String?
             
-            let tracksInformation = inputMedia.tracksInformation as! [[String:AnyObject]]
+            let tracksInformation = probe.tracksInformation
             for properties in tracksInformation {
                 guard let type = properties["type"] as? String else {
                     continue
@@ -278,6 +394,13 @@ class VideoConversionStateMachine: GKStateMachine {
                 for (key, value) in newOptions {
                     transcodingOptions[key] = value
                 }
+                
+                //  x264's own key frame placement would let livehttp's segments run long
+                if useHLS {
+                    let frameRate = probe.videoFrameRate ?? kOVCAssumedFrameRate
+                    let keyframeInterval = max(1, Int(round(frameRate * Double(kOVCSegmenterSegmentDuration))))
+                    transcodingOptions["videoEncoder"] = "x264{keyint=\(keyframeInterval),min-keyint=\(keyframeInterval),scenecut=-1}"
+                }
             }
             
             if audioNeedsTranscode {
@@ -306,10 +429,88 @@ class VideoConversionStateMachine: GKStateMachine {
             switch conversionType {
             case let .httpLiveStreaming(m3u8Filename: m3u8Filename, filenameTemplate: _):
                 outputStreamPath = baseFilePath.stringByAppendingString(m3u8Filename)
-                mainFileURL = baseHTTPAddress.stringByAppendingString(m3u8Filename)
+                
+                //  livehttp writes short segments and its own playlist, and the
+                //  scheduler joins them into the segments listed in the served playlist
+                let sessionFilename = (m3u8Filename as NSString).stringByDeletingPathExtension
+                let segmenterPlaylistPath = baseFilePath.stringByAppendingString("\(sessionFilename)-segmenter.m3u8")
+                let scheduledFilenamePrefix = "\(sessionFilename)-scheduled-"
+                
+                let convertInParallel = !reuseOutput && kOVCParallelTranscoding && videoNeedsTranscode && metadata.duration > 2 * kOVCParallelChunkDuration
+                
+                //  a parallel conversion's complete chunks are reused by later sessions, segments and all
+                segmentScheduler = reuseOutput ? nil : HLSSegmentScheduler(
+                    startupDurations: kOVCStartupSegmentDurations.map { NSTimeInterval($0) },
+                    steadyDuration: NSTimeInterval(kOVCSegmentDuration),
+                    segmenterDuration: NSTimeInterval(kOVCSegmenterSegmentDuration),
+                    keyFramesForced: videoNeedsTranscode,
+                    segmenterPlaylistPath: segmenterPlaylistPath,
+                    playlistPath: outputStreamPath,
+                    segmentPathPrefix: baseFilePath.stringByAppendingString(scheduledFilenamePrefix),
+                    segmentURLPrefix: baseHTTPAddress.stringByAppendingString(scheduledFilenamePrefix),
+                    deletesJoinedSegments: kOVCDeleteJoinedSegments && !convertInParallel,
+                    segmentStore: segmentStore)
+                
+                //  in parallel, the engine's stitched playlist takes the place of livehttp's
+                let hlsParallelEngine: ParallelConversionEngine?
+                if convertInParallel {
+                    let chunkFilenamePrefix = "\(sessionFilename)-chunk-"
+                    
+                    hlsParallelEngine = ParallelConversionEngine(
+                        inputPath: metadata.inputPath,
+                        duration: metadata.duration,
+                        chunkDuration: kOVCParallelChunkDuration,
+                        workerCount: kOVCParallelWorkerCount,
+                        transcodingOptions: transcodingOptions,
+                        segmentDuration: kOVCSegmenterSegmentDuration,
+                        playlistPath: segmenterPlaylistPath,
+                        chunkPathPrefix: baseFilePath.stringByAppendingString(chunkFilenamePrefix),
+                        chunkURLPrefix: baseHTTPAddress.stringByAppendingString(chunkFilenamePrefix),
+                        bitrateController: bitrateController)
+                } else {
+                    hlsParallelEngine = nil
+                }
+                parallelEngine = hlsParallelEngine
+                
+                //  smaller renditions, which receivers can switch to when throughput drops.
+                //  a parallel conversion adapts its own bitrate instead, and its seeks splice
+                //  the playlist in a way that separately converted renditions couldn't follow.
+                //  video that isn't converted keeps the input's key frames, which the renditions' wouldn't line up with.
+                let renditionWidths = kOVCAdaptiveBitrate && videoNeedsTranscode && hlsParallelEngine == nil ? kOVCAdaptiveRenditionScales.map({ Int(Double(intWidth) * $0) / 2 * 2 }).filter({ $0 >= 160 }) : []
+                
+                if renditionWidths.isEmpty {
+                    mainFileURL = baseHTTPAddress.stringByAppendingString(m3u8Filename)
+                    adaptiveOutput = nil
+                } else {
+                    let masterFilename = "\(sessionFilename)-master.m3u8"
+                    mainFileURL = baseHTTPAddress.stringByAppendingString(masterFilename)
+                    
+                    let sourceDimensions = probe.videoDimensions
+                    let resolutionForWidth = { (width: Int) -> (width: Int, height: Int)? in
+                        return sourceDimensions.map { (width, Int(Double(width) * Double($0.height) / Double($0.width)) / 2 * 2) }
+                    }
+                    
+                    let audioKilobits = intAudioChannels * 128
+                    let renditionNumbers = renditionWidths.indices.map { $0 + 1 }
+                    
+                    let mainVariant = HLSRendition.Variant(playlistURL: baseHTTPAddress.stringByAppendingString(m3u8Filename), bandwidth: (intWidth * 3 + audioKilobits) * 1000, resolution: resolutionForWidth(intWidth))
+                    let renditionVariants = zip(renditionNumbers, renditionWidths).map { number, renditionWidth in
+                        HLSRendition.Variant(playlistURL: baseHTTPAddress.stringByAppendingString(HLSRendition.playlistFilename(sessionFilename, index: number)), bandwidth: (renditionWidth * 3 + audioKilobits) * 1000, resolution: resolutionForWidth(renditionWidth))
+                    }
+                    
+                    let renditions = reuseOutput ? [] : zip(renditionNumbers, renditionWidths).map { number, renditionWidth in
+                        HLSRendition(inputPath: metadata.inputPath, index: number, width: renditionWidth, transcodingOptions: transcodingOptions, baseFilePath: baseFilePath, baseHTTPAddress: baseHTTPAddress, sessionFilename: sessionFilename, segmentStore: segmentStore)
+                    }
+                    
+                    adaptiveOutput = AdaptiveOutput(
+                        masterPlaylistPath: baseFilePath.stringByAppendingString(masterFilename),
+                        variants: [mainVariant] + renditionVariants,
+                        renditions: renditions,
+                        renditionPlaylistPaths: renditionNumbers.map { baseFilePath.stringByAppendingString(HLSRendition.playlistFilename(sessionFilename, index: $0)) })
+                }
                 
                 let videoFileURL = baseHTTPAddress.stringByAppendingString(outFilenameOrTemplate)
-                access = "livehttp{seglen=\(kOVCSegmentDuration),delsegs=false,index=\(outputStreamPath),index-url=\(videoFileURL)}"
+                access = "livehttp{seglen=\(kOVCSegmenterSegmentDuration),delsegs=false,index=\(segmenterPlaylistPath),index-url=\(videoFileURL)}"
                 outputOptions = [
                     "access" :  access,
                     "muxer" : "\(kOVCHLSOutputFiletype){use-key-frames}",
@@ -318,6 +519,9 @@ class VideoConversionStateMachine: GKStateMachine {
             case let .video(filename: filename):
                 outputStreamPath = mainFilePath
                 mainFileURL = baseHTTPAddress.stringByAppendingString(filename)
+                segmentScheduler = nil
+                parallelEngine = nil
+                adaptiveOutput = nil
                 
                 access = "file"
                 outputOptions = [
@@ -329,18 +533,92 @@ class VideoConversionStateMachine: GKStateMachine {
             
             streamOutputOptions["outputOptions"] = outputOptions
             
-            let output = VLCStreamOutput(optionDictionary: streamOutputOptions)
-            session.streamOutput = output
+            //  a complete video file can't be played until it's finished, so there's no getting ahead of the receiver.
+            //  before its turn, an input is paced to stop after its opening.
+            if (kOVCPacedConversion || preconverting) && !reuseOutput && useHLS {
+                let maximumLead = preconverting ? kOVCPreconversionDuration : ConvertingState.pacingLead
+                pacingGovernor = TranscodePacingGovernor(maximumLead: maximumLead, minimumLead: preconverting ? maximumLead : maximumLead / 2)
+            } else {
+                pacingGovernor = nil
+            }
             
-            super.init()
+            if parallelEngine != nil || reuseOutput {
+                session = nil
+            } else {
+                // Maybe the wrong initializer for VLCStreamSession?
+                let session = VLCStreamSession()
+                session.media = inputMedia
+                
+                let output = VLCStreamOutput(optionDictionary: streamOutputOptions)
+                session.streamOutput = output
+                
+                self.session = session
+            }
             
-            //  give VLCKit at least one segment duration before checking
-            //  for the playlist file
-            NSTimer.scheduledTimerWithTimeInterval(NSTimeInterval(kOVCSegmentDuration), target: self, selector: #selector(ConvertingState.waitForOutputStream), userInfo: nil, repeats: false)
+            super.init()
         }
         
         override func didEnterWithPreviousState(previousState: GKState?) {
-            session.startStreaming()
+            //  playlists left over from an unfinished earlier session would look ready
+            if cacheEntry != nil && !reusingOutput {
+                removeStaleOutput()
+            }
+            
+            if let adaptiveOutput = adaptiveOutput {
+                HLSRendition.writeMasterPlaylist(adaptiveOutput.masterPlaylistPath, variants: adaptiveOutput.variants)
+            }
+            
+            hasEntered = true
+            
+            //  a complete video file can't be stopped after its opening, so it waits for its turn
+            if !isPreconverting || pacingGovernor != nil {
+                startConversion()
+            }
+            
+            if pacingGovernor != nil || isPreconverting {
+                pacingTimer = NSTimer.scheduledTimerWithTimeInterval(kOVCPacingInterval, target: self, selector: #selector(ConvertingState.updatePacing), userInfo: nil, repeats: true)
+            }
+            
+            watchForOutputStream()
+        }
+        
+        /// Convert at the usual pace for playback, after converting ahead of the input's turn in the play queue.
+        func beginPlayback() {
+            guard isPreconverting else {
+                return
+            }
+            
+            isPreconverting = false
+            
+            //  not entered yet, so it starts out like any other conversion
+            guard hasEntered else {
+                return
+            }
+            
+            pacingGovernor?.isHeld = false
+            pacingGovernor?.maximumLead = kOVCPacedConversion ? ConvertingState.pacingLead : NSTimeInterval.infinity
+            pacingGovernor?.minimumLead = kOVCPacedConversion ? ConvertingState.pacingLead / 2 : NSTimeInterval.infinity
+            
+            if !conversionStarted {
+                startConversion()
+            }
+            
+            updatePacing()
+            
+            if outputReady {
+                delegate?.convertingStateOutputReady(self)
+            }
+        }
+        
+        override func willExitWithNextState(nextState: GKState) {
+            directoryWatcher?.cancel()
+            directoryWatcher = nil
+            ingestTimer?.invalidate()
+            ingestTimer = nil
+            pacingTimer?.invalidate()
+            pacingTimer = nil
+            completionTimer?.invalidate()
+            completionTimer = nil
         }
         
         override func isValidNextState(stateClass: AnyClass) -> Bool {
@@ -348,38 +626,329 @@ class VideoConversionStateMachine: GKStateMachine {
             return stateClass is StoppedState.Type
         }
         
+        /// A direct play input is complete from the start.
+        private var conversionComplete: Bool {
+            let renditionsComplete = adaptiveOutput?.renditions.reduce(true) { $0 && $1.isComplete } ?? true
+            guard renditionsComplete else {
+                return false
+            }
+            
+            if let parallelEngine = parallelEngine {
+                return parallelEngine.isComplete
+            }
+            
+            return session?.isComplete ?? true
+        }
+        
+        func stopConversion() {
+            session?.stopStreaming()
+            parallelEngine?.stop()
+            adaptiveOutput?.renditions.forEach { $0.stop() }
+        }
+        
+        /**
+         Get the input from `position` on converted as soon as possible, and return the position
+         in the output to have the receiver seek to.
+         
+         Only a parallel conversion can skip ahead; anything else is converted in order, and the two positions are the same.
+         */
+        func seekToPosition(position: NSTimeInterval) -> NSTimeInterval {
+            let playbackPosition = parallelEngine?.seek(position) ?? position
+            
+            //  get going on the target straight away, rather than on the next position update
+            updatePlaybackPosition(position)
+            
+            return playbackPosition
+        }
+        
+        /// Record how far into the input the receiver has played, pausing or resuming the conversion to match.
+        func updatePlaybackPosition(position: NSTimeInterval) {
+            pacingGovernor?.playbackPosition = position
+            updatePacing()
+            
+            retainSegmentsAroundPosition(position)
+        }
+        
+        /// The position in the input of `playbackPosition` in the output, which differ once a seek has skipped ahead.
+        func mediaPositionForPlaybackPosition(playbackPosition: NSTimeInterval) -> NSTimeInterval {
+            return parallelEngine?.mediaTimeForPlaylistTime(playbackPosition) ?? playbackPosition
+        }
+        
+        /// Seconds of output a paced conversion keeps ahead of the receiver.
+        private static let pacingLead = NSTimeInterval(kOVCPacingLeadSegments * Int(kOVCSegmentDuration))
+        
+        /**
+         Delete the segments of a parallel conversion that end more than the rewind window before `position`,
+         and convert any that were deleted from just ahead of it again. Only chunks can be converted again,
+         so output converted by a single session is left alone.
+         */
+        private func retainSegmentsAroundPosition(position: NSTimeInterval) {
+            guard let parallelEngine = parallelEngine, segmentScheduler = segmentScheduler else {
+                return
+            }
+            
+            parallelEngine.regenerateChunks(from: position, through: position + ConvertingState.pacingLead)
+            if let playlistPosition = parallelEngine.playlistTimeForMediaTime(position) {
+                segmentScheduler.restoreDiscardedSegments(from: playlistPosition, through: playlistPosition + ConvertingState.pacingLead)
+            }
+            
+            let discardTime = position - kOVCSegmentRewindWindow
+            guard discardTime > 0, let playlistDiscardTime = parallelEngine.playlistTimeForMediaTime(discardTime) else {
+                return
+            }
+            
+            parallelEngine.discardChunks(endingBefore: discardTime)
+            segmentScheduler.discardSegments(endingBefore: playlistDiscardTime)
+        }
+        
+        private func startConversion() {
+            conversionStarted = true
+            
+            streamingStartDate = NSDate()
+            session?.startStreaming()
+            parallelEngine?.start()
+            adaptiveOutput?.renditions.forEach { $0.start() }
+        }
+        
+        /// How far into the input every part of the conversion has got, in seconds.
+        private var convertedPosition: NSTimeInterval {
+            var positions = adaptiveOutput?.renditions.map { $0.convertedPosition } ?? []
+            
+            if let parallelEngine = parallelEngine {
+                positions.append(parallelEngine.convertedPosition)
+            } else if let session = session {
+                positions.append(session.convertedPosition)
+            }
+            
+            return positions.minElement() ?? 0
+        }
+        
+        @objc private func updatePacing() {
+            //  a conversion ahead of its turn only runs while the processors have time to spare
+            if isPreconverting {
+                let withinBudget = (hostCPULoad.sample() ?? 1) < kOVCPreconversionCPUBudget
+                pacingGovernor?.isHeld = !withinBudget
+            }
+            
+            guard let pacingGovernor = pacingGovernor else {
+                if !isPreconverting {
+                    pacingTimer?.invalidate()
+                    pacingTimer = nil
+                }
+                return
+            }
+            
+            guard !conversionComplete else {
+                pacingTimer?.invalidate()
+                pacingTimer = nil
+                return
+            }
+            
+            guard pacingGovernor.update(convertedPosition) else {
+                return
+            }
+            
+            let paused = pacingGovernor.isPaused
+            session?.setConversionPaused(paused)
+            parallelEngine?.isPaused = paused
+            adaptiveOutput?.renditions.forEach { $0.setPaused(paused) }
+        }
+        
+        //  watch the output directory, so we notice the playlist as soon as VLCKit
+        //  writes it. a complete video file can only be detected by polling the session.
+        private func watchForOutputStream() {
+            if usingHLS {
+                let outputDirectory = (outputStreamPath as NSString).stringByDeletingLastPathComponent
+                directoryWatcher = FileSystemWatcher(path: outputDirectory) { [weak self] in
+                    self?.outputDirectoryDidChange()
+                }
+            }
+            
+            //  the output may have appeared before we started watching
+            outputDirectoryDidChange()
+        }
+        
+        private func outputDirectoryDidChange() {
+            guard !outputReady else {
+                //  every segment VLCKit finishes lands in the output directory,
+                //  along with a rewritten playlist
+                if usingHLS {
+                    ingestSegments()
+                }
+                return
+            }
+            
+            waitForOutputStream()
+        }
+        
         //  wait for the output file for this session to be created,
         //  i.e. the .m3u8 file for HLS (or the actual video file otherwise) has
         //  been created for the input video
         @objc private func waitForOutputStream() {
+            guard !outputReady else {
+                return
+            }
+            
+            //  poll only if there's nothing watching the file system for us
             let makeTimer = { () -> Void in
+                guard self.directoryWatcher == nil else {
+                    return
+                }
+                
                 NSTimer.scheduledTimerWithTimeInterval(2, target: self, selector: #selector(ConvertingState.waitForOutputStream), userInfo: nil, repeats: false)
             }
             
-            let isReady = (usingHLS && NSFileManager.defaultManager().fileExistsAtPath(outputStreamPath)) || session.isComplete
+            segmentScheduler?.update()
+            adaptiveOutput?.renditions.forEach { $0.update() }
+            
+            let isReady: Bool
+            if usingHLS {
+                //  a receiver may pick any variant in the master playlist, so wait for all of them
+                let playlistPaths = [outputStreamPath] + (adaptiveOutput?.renditionPlaylistPaths ?? [])
+                isReady = playlistPaths.reduce(true) { $0 && NSFileManager.defaultManager().fileExistsAtPath($1) } || conversionComplete
+            } else {
+                isReady = conversionComplete
+            }
             
             guard isReady else {
                 makeTimer()
                 return
             }
             
-            if session.isComplete {
-                session.stopStreaming()
+            outputReady = true
+            
+            recordReadinessMeasurement()
+            
+            if conversionComplete {
+                stopConversion()
+                recordConversionReport()
+            } else {
+                completionTimer = NSTimer.scheduledTimerWithTimeInterval(kOVCSegmentIngestInterval, target: self, selector: #selector(ConvertingState.checkForCompletion), userInfo: nil, repeats: true)
+            }
+            
+            //  load the first segments into memory right away, so they're ready
+            //  by the time the receiver asks for them
+            if usingHLS && segmentStore != nil {
+                ingestSegments()
+                
+                if directoryWatcher == nil {
+                    ingestTimer = NSTimer.scheduledTimerWithTimeInterval(kOVCSegmentIngestInterval, target: self, selector: #selector(ConvertingState.ingestSegments), userInfo: nil, repeats: true)
+                }
+            }
+            
+            //  the play queue starts playback when it's the input's turn
+            if !isPreconverting {
+                delegate?.convertingStateOutputReady(self)
+            }
+        }
+        
+        //  pick up any segments that VLCKit has finished since we last looked
+        @objc private func ingestSegments() {
+            //  the schedulers store the segments they join themselves. only output
+            //  that's already complete, from an earlier session, is read from its playlists.
+            if let segmentScheduler = segmentScheduler {
+                segmentScheduler.update()
+            } else {
+                segmentStore?.ingestSegmentsListedInPlaylist(outputStreamPath)
+            }
+            
+            if let adaptiveOutput = adaptiveOutput where adaptiveOutput.renditions.isEmpty {
+                for playlistPath in adaptiveOutput.renditionPlaylistPaths {
+                    segmentStore?.ingestSegmentsListedInPlaylist(playlistPath)
+                }
+            } else {
+                adaptiveOutput?.renditions.forEach { $0.update() }
+            }
+            
+            if conversionComplete {
+                ingestTimer?.invalidate()
+                ingestTimer = nil
+            }
+        }
+        
+        private func recordReadinessMeasurement() {
+            let timeToReady = NSDate().timeIntervalSinceDate(streamingStartDate)
+            
+            //  the timer used to wait one segment duration before the first check,
+            //  and then check again every 2 seconds
+            let firstCheck = NSTimeInterval(kOVCSegmentDuration)
+            let checkInterval: NSTimeInterval = 2
+            let checksAfterFirst = max(0, ceil((timeToReady - firstCheck) / checkInterval))
+            let polledTimeToReady = firstCheck + checksAfterFirst * checkInterval
+            
+            let measurement = ReadinessMeasurement(timeToReady: timeToReady, polledTimeToReady: polledTimeToReady)
+            readinessMeasurement = measurement
+            
+            if kOVCEnableDebugOutput {
+                print(String(format: "Output ready after %.2f s, %.2f s sooner than polling", measurement.timeToReady, measurement.savedLatency))
+            }
+        }
+        
+        @objc private func checkForCompletion() {
+            guard conversionComplete else {
+                return
+            }
+            
+            //  pick up the last segments
+            if usingHLS {
+                ingestSegments()
+            }
+            
+            completionTimer?.invalidate()
+            completionTimer = nil
+            
+            recordConversionReport()
+        }
+        
+        private func removeStaleOutput() {
+            let fileManager = NSFileManager.defaultManager()
+            
+            let renditionPaths = adaptiveOutput?.renditions.flatMap { $0.stalePaths } ?? []
+            
+            for path in [outputStreamPath, segmentScheduler?.segmenterPlaylistPath].flatMap({ $0 }) + renditionPaths where fileManager.fileExistsAtPath(path) {
+                do {
+                    try fileManager.removeItemAtPath(path)
+                } catch {
+                    print("Couldn't remove stale output: \(path), \(error)")
+                }
+            }
+        }
+        
+        private func recordConversionReport() {
+            guard !playingDirectly && !reusingOutput && conversionReport == nil else {
+                return
+            }
+            
+            //  only full bitrate output, with every segment still on disk, is worth replaying as it is
+            if parallelEngine?.outputIsReplayable ?? true {
+                cacheEntry?.markComplete()
             }
             
-            delegate?.convertingStateOutputReady(self)
+            //  time spent waiting on the receiver isn't time spent converting
+            let elapsedTime = parallelEngine?.conversionTime ?? NSDate().timeIntervalSinceDate(streamingStartDate)
+            let conversionTime = elapsedTime - (pacingGovernor?.pausedDuration ?? 0)
+            let workerCount = parallelEngine?.workerCount ?? 1
+            
+            let report = ConversionReport(mediaDuration: metadata.duration, conversionTime: conversionTime, workerCount: workerCount)
+            conversionReport = report
+            
+            if kOVCEnableDebugOutput {
+                print(String(format: "Converted %.0f s of media in %.1f s with %d session(s), %.2fx realtime", report.mediaDuration, report.conversionTime, report.workerCount, report.realtimeFactor))
+            }
+            
+            delegate?.convertingStateConversionComplete(self)
         }
     }
     
     class StoppedState: GKState {
-        let session: VLCStreamSession
+        let convertingState: ConvertingState
         
-        init(session: VLCStreamSession) {
-            self.session = session
+        init(convertingState: ConvertingState) {
+            self.convertingState = convertingState
         }
         
         override func didEnterWithPreviousState(previousState: GKState?) {
-            session.stopStreaming()
+            convertingState.stopConversion()
         }
         
         override func isValidNextState(stateClass: AnyClass) -> Bool {
@@ -389,6 +958,36 @@ class VideoConversionStateMachine: GKStateMachine {
     }
 }
 
+private extension VideoConversionStateMachine.ConvertingState {
+    /**
+     Link the input file into the directory the HTTP server serves, so it can be served directly.
+     The server resolves the link, so the response is the input file itself, with byte ranges and all.
+     
+     Returns the filename of the link, or `nil` if it couldn't be made.
+     */
+    static func linkInputFile(metadata: VideoConversionStateMachine.Metadata, baseFilePath: String) -> String? {
+        let fileManager = NSFileManager.defaultManager()
+        
+        let pathExtension = (metadata.inputPath as NSString).pathExtension
+        let filename = "\(metadata.sessionID)-direct.\(pathExtension)"
+        let linkPath = baseFilePath.stringByAppendingString(filename)
+        
+        do {
+            if let _ = try? fileManager.destinationOfSymbolicLinkAtPath(linkPath) {
+                try fileManager.removeItemAtPath(linkPath)
+            }
+            
+            try fileManager.createSymbolicLinkAtPath(linkPath, withDestinationPath: metadata.inputPath)
+        } catch {
+            print("Couldn't link input file for direct play: \(metadata.inputPath), \(error)")
+            return nil
+        }
+        
+        return filename
+    }
+}
+
 protocol ConvertingStateDelegate: class {
     func convertingStateOutputReady(convertingState: VideoConversionStateMachine.ConvertingState)
+    func convertingStateConversionComplete(convertingState: VideoConversionStateMachine.ConvertingState)
 }
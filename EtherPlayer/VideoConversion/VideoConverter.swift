@@ -11,12 +11,72 @@ import Cocoa
 import Foundation
 
 import VLCKit
-    
+
 let kOVCNormalOutputFiletype: String = "mp4"
 let kOVCHLSOutputFiletype: String = "ts"
 let kOVCSegmentDuration: UInt = 15
+//  the first HLS segments are shorter, so playback can start sooner
+let kOVCStartupSegmentDurations: [UInt] = [2, 2, 4, 6]
+//  livehttp cuts segments this long, which are then joined to follow the schedule above
+let kOVCSegmenterSegmentDuration: UInt = ([kOVCSegmentDuration] + kOVCStartupSegmentDurations).minElement()!
+//  transcoded HLS video gets a key frame every segmenter duration and nowhere else, so livehttp can cut
+//  segments to length. inputs whose frame rate isn't known are taken to run at this rate, which is high,
+//  so key frames come at least that often.
+let kOVCAssumedFrameRate: Double = 60
+//  video that isn't transcoded keeps the input's key frames, so livehttp's segments can run to any length.
+//  its HLS playlists are given this target duration up front, and segments are cut short to fit it.
+let kOVCUnforcedTargetDuration: UInt = 15
 let kOVCIncludeSubs: Bool = false
+//  print what conversions are doing: seek splices, bitrate changes, pacing and timings
+let kOVCEnableDebugOutput: Bool = false
 let kOVCCleanTempDir: Bool = false
+let kOVCSegmentStoreCapacity: Int = 256 * 1024 * 1024
+let kOVCSegmentIngestInterval: NSTimeInterval = 1
+//  conversion output is kept for replays, up to this many bytes
+let kOVCTranscodeCacheBudget: UInt64 = 20 * 1024 * 1024 * 1024
+//  change when the conversion changes in a way the settings below don't capture,
+//  so earlier output isn't reused
+let kOVCTranscodeCacheVersion: Int = 3
+//  convert HLS that needs its video transcoded in chunks, with several VLCKit sessions at once.
+//  each session's encoder is multithreaded too, so give each one a couple of cores.
+let kOVCParallelTranscoding: Bool = true
+let kOVCParallelChunkDuration: NSTimeInterval = 60
+let kOVCParallelWorkerCount: Int = max(1, NSProcessInfo.processInfo().activeProcessorCount / 2)
+let kOVCParallelPollInterval: NSTimeInterval = 0.5
+//  serve input files that AirPlay devices can already play as they are, rather than converting them
+let kOVCAllowDirectPlay: Bool = true
+//  also convert HLS at these fractions of the main width, and list them all in a master playlist,
+//  so receivers can drop to a smaller rendition when their throughput drops.
+//  this only applies to transcoded inputs too short to convert in parallel, i.e. at most two parallel
+//  chunks long. longer ones are converted by the parallel engine, which lowers the bitrate of
+//  upcoming chunks instead, as renditions converted separately couldn't follow its seek splices.
+let kOVCAdaptiveBitrate: Bool = true
+let kOVCAdaptiveRenditionScales: [Double] = [0.5, 0.25]
+//  convert upcoming chunks at a bitrate that fits in this fraction of the receiver's measured goodput.
+//  goodput drops are followed quickly, and recoveries slowly, so the bitrate doesn't oscillate.
+let kOVCBitrateSafetyMargin: Double = 0.7
+let kOVCMinimumVideoBitrate: Int = 400
+let kOVCGoodputDropGain: Double = 0.5
+let kOVCGoodputRecoveryGain: Double = 0.125
+//  a seek this far past what's converted skips ahead, rather than waiting for the conversion to get there
+let kOVCSeekSpliceThreshold: NSTimeInterval = 20
+//  pause conversions once they're this many segments ahead of the receiver's playback position,
+//  and resume them once the receiver is within half of that. complete video files,
+//  which can't be played until the end, aren't paced.
+let kOVCPacedConversion: Bool = true
+let kOVCPacingLeadSegments: Int = 4
+let kOVCPacingInterval: NSTimeInterval = 1
+//  parallel conversions delete segments that end this long before the receiver's playback position,
+//  and convert their chunks again once playback gets back near them. output with deleted segments isn't replayable.
+let kOVCSegmentRewindWindow: NSTimeInterval = 10 * 60
+//  delete livehttp's segments once they've been joined into the served ones
+let kOVCDeleteJoinedSegments: Bool = true
+//  convert the opening of the next queued input while the current one plays, so it starts straight away.
+//  it only runs while the machine's processors are less busy than the budget, which mostly means while
+//  the current conversion is paced, so it doesn't slow down what's playing now.
+let kOVCPreconvertQueuedMedia: Bool = true
+let kOVCPreconversionDuration: NSTimeInterval = 30
+let kOVCPreconversionCPUBudget: Double = 0.75
 
 class VideoConverter: NSObject {
     typealias Metadata = VideoConversionStateMachine.Metadata
@@ -29,13 +89,33 @@ class VideoConverter: NSObject {
     var useHTTPLiveStreaming: Bool = false
     
     let httpServer: HTTPServer
+    /// HLS segments kept in memory, which `httpServer` serves before falling back to disk.
+    let segmentStore: SegmentStore
+    /// Conversion output from earlier sessions, kept under `baseFilePath`.
+    let transcodeCache: TranscodeCache
+    /// What's known about input files, so they needn't be parsed every time they're played.
+    let probeIndex: MediaProbeIndex
+    /// Lowers the bitrate of upcoming conversion work when the receiver can't download it fast enough.
+    let bitrateController: DeliveryBitrateController
     let baseHTTPAddress: String
     var sessionRandom: UInt32 = 0
     
     var currentConversionHTTPFilePath: String?
     
+    /// Inputs to play after the current one, in order.
+    private(set) var queuedPaths: [String] = []
+    
     private var stateMachine: VideoConversionStateMachine = VideoConversionStateMachine(states: [])
     
+    /// The next queued input, converting ahead of its turn.
+    private var preparedConversion: Conversion?
+    
+    /// Inputs whose cache entries are being looked up, before their conversions can be made.
+    private var pendingConversionPath: String?
+    private var preparingConversionPath: String?
+    /// Changed whenever a conversion is started or stopped, so lookups that finish after that are dropped.
+    private var conversionGeneration = 0
+    
     /// `false` to force outputting a single video file, even with conversion to HLS
     /// would be possible without transcoding
     private let useHLS: Bool = true
@@ -66,8 +146,20 @@ class VideoConverter: NSObject {
             }
         }
         
+        segmentStore = SegmentStore(capacity: kOVCSegmentStoreCapacity)
+        
+        //  unlike converted output, probes are small, so keep them somewhere that lasts
+        let cachesPath = NSSearchPathForDirectoriesInDomains(.CachesDirectory, .UserDomainMask, true).first ?? tempDir
+        let probeIndexDirectory = (cachesPath as NSString).stringByAppendingPathComponent(bundleIdentifier)
+        _ = try? fileManager.createDirectoryAtPath(probeIndexDirectory, withIntermediateDirectories: true, attributes: nil)
+        probeIndex = MediaProbeIndex(indexPath: (probeIndexDirectory as NSString).stringByAppendingPathComponent("MediaProbeIndex.plist"))
+        transcodeCache = TranscodeCache(directoryPath: "\(baseFilePath)TranscodeCache/", budget: kOVCTranscodeCacheBudget)
+        
+        bitrateController = DeliveryBitrateController(safetyMargin: kOVCBitrateSafetyMargin, minimumVideoBitrate: kOVCMinimumVideoBitrate)
+        
         httpServer = HTTPServer()
         httpServer.setDocumentRoot(baseFilePath)
+        httpServer.setDataStore(segmentStore)
         httpServer.setPort(6004)
         
         do {
@@ -135,40 +227,64 @@ class VideoConverter: NSObject {
         
         NSUserDefaults.standardUserDefaults().setObject(defaultParams, forKey: "VLCParams")
     }
-
+    
     func convertMedia(path: String) {
-        sessionRandom = arc4random()
+        //  the outgoing conversion's sessions and timers would keep running, and keep filling the segment store
+        if stateMachine.currentState != nil && !(stateMachine.currentState is VideoConversionStateMachine.StoppedState) {
+            stateMachine.enterState(VideoConversionStateMachine.StoppedState.self)
+        }
+        
+        conversionGeneration += 1
+        pendingConversionPath = nil
+        preparingConversionPath = nil
         
-        let ready = VideoConversionStateMachine.ReadyState(sessionID: sessionRandom, mediaPath: path, allowHLS: useHLS)
-        let parsing = VideoConversionStateMachine.ParsingState(metadata: ready.metadata) { [unowned self] in
-            self.stateMachine.enterState(VideoConversionStateMachine.ConvertingState.self)
+        //  the next input may already be under way, and its first segments already stored.
+        //  those of earlier sessions are the least recently used, so they're evicted first.
+        if let prepared = preparedConversion where prepared.path == path {
+            preparedConversion = nil
+            startConversion(prepared)
+            return
         }
         
-        let metadata = ready.metadata
-        let converting = VideoConversionStateMachine.ConvertingState(metadata: metadata, baseHTTPAddress: baseHTTPAddress, baseFilePath: baseFilePath)
-        converting.delegate = self
+        preparedConversion?.stateMachine.enterState(VideoConversionStateMachine.StoppedState.self)
+        preparedConversion = nil
         
-        let stopped = VideoConversionStateMachine.StoppedState(session: converting.session)
+        // Segments from earlier sessions won't be requested again
+        segmentStore.removeAllSegments()
         
-        let states = [
-            ready,
-            parsing,
-            converting,
-            stopped,
-            ]
-        stateMachine = VideoConversionStateMachine(states: states)
-        stateMachine.enterState(VideoConversionStateMachine.ReadyState.self)
+        //  converting the same input with the same settings again gives the same
+        //  output, so reuse whatever is left from last time
+        let generation = conversionGeneration
+        pendingConversionPath = path
+        transcodeCache.fetchEntryForInput(VideoConversionStateMachine.ReadyState.inputPathForMediaPath(path), settings: transcodeSettings) { cacheEntry in
+            guard generation == self.conversionGeneration else {
+                return
+            }
+            
+            self.pendingConversionPath = nil
+            self.startConversion(self.makeConversion(path, cacheEntry: cacheEntry, preconverting: false))
+        }
+    }
+    
+    /// Play `path` once the current input and everything queued before it has played, or now if nothing is playing.
+    func enqueueMedia(path: String) {
+        guard pendingConversionPath != nil || (stateMachine.currentState != nil && !(stateMachine.currentState is VideoConversionStateMachine.StoppedState)) else {
+            convertMedia(path)
+            return
+        }
         
-        let filenameToServe: String
-        switch ready.conversionType {
-        case let .httpLiveStreaming(m3u8Filename: m3u8Filename, filenameTemplate: _):
-            filenameToServe = m3u8Filename
-        case let .video(filename: filename):
-            filenameToServe = filename
+        queuedPaths.append(path)
+        prepareNextQueuedMedia()
+    }
+    
+    /// Play the next queued input. Returns `false` if the queue is empty.
+    func playNextQueuedMedia() -> Bool {
+        guard !queuedPaths.isEmpty else {
+            return false
         }
         
-        currentConversionHTTPFilePath = baseHTTPAddress.stringByAppendingString(filenameToServe)
-        stateMachine.enterState(VideoConversionStateMachine.ParsingState.self)
+        convertMedia(queuedPaths.removeFirst())
+        return true
     }
     
     func cleanup() {
@@ -195,8 +311,47 @@ class VideoConverter: NSObject {
     }
     
     func stop() {
+        conversionGeneration += 1
+        pendingConversionPath = nil
+        preparingConversionPath = nil
+        
         let stopped = stateMachine.enterState(VideoConversionStateMachine.StoppedState.self)
         assert(stopped)
+        
+        //  stopping playback stops the queue with it
+        preparedConversion?.stateMachine.enterState(VideoConversionStateMachine.StoppedState.self)
+        preparedConversion = nil
+        queuedPaths.removeAll()
+    }
+    
+    /**
+     Get the input from `position` on converted as soon as possible, and return the position
+     in the output to have the receiver seek to.
+     */
+    func seekToPosition(position: NSTimeInterval) -> NSTimeInterval {
+        guard let converting = stateMachine.currentState as? VideoConversionStateMachine.ConvertingState else {
+            return position
+        }
+        
+        return converting.seekToPosition(position)
+    }
+    
+    /// Let the conversion know how far into the input the receiver has played, so it can keep its pace.
+    func playbackPositionDidChange(position: NSTimeInterval) {
+        guard let converting = stateMachine.currentState as? VideoConversionStateMachine.ConvertingState else {
+            return
+        }
+        
+        converting.updatePlaybackPosition(position)
+    }
+    
+    /// The position in the input of `playbackPosition`, as reported by the receiver.
+    func mediaPositionForPlaybackPosition(playbackPosition: NSTimeInterval) -> NSTimeInterval {
+        guard let converting = stateMachine.currentState as? VideoConversionStateMachine.ConvertingState else {
+            return playbackPosition
+        }
+        
+        return converting.mediaPositionForPlaybackPosition(playbackPosition)
     }
 }
 
@@ -205,10 +360,128 @@ extension VideoConverter: ConvertingStateDelegate {
         let httpAddress = convertingState.mainFileURL
         let metadata = convertingState.metadata
         delegate?.videoConverter(self, outputReadyWithHTTPAddress: httpAddress, metadata: metadata)
+        
+        prepareNextQueuedMedia()
+    }
+    
+    func convertingStateConversionComplete(convertingState: VideoConversionStateMachine.ConvertingState) {
+        //  the finished output may have taken the cache past its budget
+        let keptEntries = [convertingState.cacheEntry, preparedConversion?.convertingState.cacheEntry, currentConvertingState?.cacheEntry]
+        transcodeCache.evictEntries(keeping: keptEntries.flatMap { $0 })
     }
 }
 
 private extension VideoConverter {
+    /// A conversion of a single input, and the state machine that drives it.
+    struct Conversion {
+        let path: String
+        let sessionID: UInt32
+        let stateMachine: VideoConversionStateMachine
+        let convertingState: VideoConversionStateMachine.ConvertingState
+    }
+    
+    var currentConvertingState: VideoConversionStateMachine.ConvertingState? {
+        return stateMachine.currentState as? VideoConversionStateMachine.ConvertingState
+    }
+    
+    /**
+     Set up the conversion of `path`, with its output in `cacheEntry` if there is one, and get it parsing
+     if it's `preconverting`, i.e. being converted ahead of its turn. Otherwise, it's left in its ready state.
+     */
+    func makeConversion(path: String, cacheEntry: TranscodeCache.Entry?, preconverting: Bool) -> Conversion {
+        let sessionID = cacheEntry?.sessionID ?? arc4random()
+        let outputFilePath = cacheEntry.map { baseFilePath.stringByAppendingString($0.relativePath) } ?? baseFilePath
+        let outputHTTPAddress = cacheEntry.map { baseHTTPAddress.stringByAppendingString($0.relativePath) } ?? baseHTTPAddress
+        
+        //  the state machine is made after its states, so parsing finds it through this
+        weak var conversionStateMachine: VideoConversionStateMachine?
+        
+        let ready = VideoConversionStateMachine.ReadyState(sessionID: sessionID, mediaPath: path, allowHLS: useHLS, probeIndex: probeIndex)
+        let parsing = VideoConversionStateMachine.ParsingState(metadata: ready.metadata) {
+            conversionStateMachine?.enterState(VideoConversionStateMachine.ConvertingState.self)
+        }
+        
+        let metadata = ready.metadata
+        let converting = VideoConversionStateMachine.ConvertingState(metadata: metadata, baseHTTPAddress: outputHTTPAddress, baseFilePath: outputFilePath, segmentStore: segmentStore, cacheEntry: cacheEntry, probeIndex: probeIndex, bitrateController: bitrateController, preconverting: preconverting)
+        converting.delegate = self
+        
+        let stopped = VideoConversionStateMachine.StoppedState(convertingState: converting)
+        
+        let states = [
+            ready,
+            parsing,
+            converting,
+            stopped,
+            ]
+        let machine = VideoConversionStateMachine(states: states)
+        conversionStateMachine = machine
+        machine.enterState(VideoConversionStateMachine.ReadyState.self)
+        
+        if preconverting {
+            machine.enterState(VideoConversionStateMachine.ParsingState.self)
+        }
+        
+        return Conversion(path: path, sessionID: sessionID, stateMachine: machine, convertingState: converting)
+    }
+    
+    /// Make `conversion` the current one, and get it under way if it isn't already.
+    func startConversion(conversion: Conversion) {
+        sessionRandom = conversion.sessionID
+        stateMachine = conversion.stateMachine
+        transcodeCache.evictEntries(keeping: [conversion.convertingState.cacheEntry].flatMap { $0 })
+        
+        //  not necessarily what the conversion type suggests, as the input may be played directly
+        currentConversionHTTPFilePath = conversion.convertingState.mainFileURL
+        conversion.convertingState.beginPlayback()
+        
+        if stateMachine.currentState is VideoConversionStateMachine.ReadyState {
+            stateMachine.enterState(VideoConversionStateMachine.ParsingState.self)
+        }
+    }
+    
+    //  convert the opening of the next input while the current one plays, once the current one is under way
+    func prepareNextQueuedMedia() {
+        guard kOVCPreconvertQueuedMedia, let nextPath = queuedPaths.first where preparedConversion?.path != nextPath && preparingConversionPath != nextPath else {
+            return
+        }
+        
+        guard let converting = currentConvertingState where converting.outputReady else {
+            return
+        }
+        
+        preparedConversion?.stateMachine.enterState(VideoConversionStateMachine.StoppedState.self)
+        preparedConversion = nil
+        
+        let generation = conversionGeneration
+        preparingConversionPath = nextPath
+        transcodeCache.fetchEntryForInput(VideoConversionStateMachine.ReadyState.inputPathForMediaPath(nextPath), settings: transcodeSettings) { cacheEntry in
+            guard generation == self.conversionGeneration && self.preparingConversionPath == nextPath else {
+                return
+            }
+            
+            self.preparingConversionPath = nil
+            self.preparedConversion = self.makeConversion(nextPath, cacheEntry: cacheEntry, preconverting: true)
+            
+            let keptEntries = [converting.cacheEntry, cacheEntry]
+            self.transcodeCache.evictEntries(keeping: keptEntries.flatMap { $0 })
+        }
+    }
+    
+    /// Everything other than the input that changes the conversion output.
+    var transcodeSettings: String {
+        let settings: [String] = [
+            "version=\(kOVCTranscodeCacheVersion)",
+            "hls=\(useHLS)",
+            "segments=\(kOVCStartupSegmentDurations),\(kOVCSegmentDuration),\(kOVCSegmenterSegmentDuration)",
+            "subs=\(kOVCIncludeSubs)",
+            "direct=\(kOVCAllowDirectPlay)",
+            "parallel=\(kOVCParallelTranscoding),\(kOVCParallelChunkDuration)",
+            "abr=\(kOVCAdaptiveBitrate),\(kOVCAdaptiveRenditionScales)",
+        ]
+        
+        return settings.joinWithSeparator("|")
+    }
+    
     func convertMedia(inputMedia: VLCMedia) {
         // TODO: work out how to stop the state-machine based conversion
         stop()
@@ -44,6 +44,17 @@ extension ViewController {
         playButton.image = NSImage(named: "play.png")
     }
     
+    @IBAction func seekToPosition(sender: AnyObject?) {
+        //  the elapsed time field takes hh:mm:ss, mm:ss or seconds
+        let components = positionFieldCell.stringValue.componentsSeparatedByString(":").map { Double($0) }
+        guard !components.isEmpty && !components.contains({ $0 == nil }) else {
+            return
+        }
+        
+        let position = components.flatMap({ $0 }).reduce(0) { $0 * 60 + $1 }
+        handler.seekToPosition(position)
+    }
+    
     @IBAction func updateTarget(sender: AnyObject?) {
         let newHostName = targetSelector.selectedItem!.title
         let selectedService: NSNetService = services.filter { $0.hostName == newHostName }.first!
@@ -125,6 +136,10 @@ extension ViewController: AirplayHandlerDelegate {
         
         playButton.image = NSImage(named: "play.png")
     }
+    
+    func playbackFinished() {
+        videoConverter.playNextQueuedMedia()
+    }
 }
 
 extension ViewController: VideoConverterDelegate {